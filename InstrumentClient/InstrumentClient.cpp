@@ -1,5 +1,6 @@
 #include "InstrumentClient.h"
 
+#include "Immediate.h"
 #include "Register.h"
 
 #include <filesystem>
@@ -19,11 +20,22 @@ InstrumentClient::InstrumentClient(
         const string& rompLibPath,
         shared_ptr<BPatch> bpatchPtr,
         const string& arch,
-        const string& modSuffix) : mBpatchPtr(move(bpatchPtr)), 
-                                   mSourceFileName(sourceFileName),
-                                   mProgramName(programName),
-                                   mArchitecture(arch),
-                                   mModuleSuffix(modSuffix) {
+        const string& modSuffix,
+        bool filterStackAccesses,
+        bool mergeRedundantAccesses,
+        bool hoistLoopAccesses,
+        bool guardAccesses) : mBpatchPtr(move(bpatchPtr)), 
+                              mBeginLoopAccessFunction(nullptr),
+                              mEndLoopAccessFunction(nullptr),
+                              mNumActiveParallelRegions(nullptr),
+                              mFilterStackAccesses(filterStackAccesses),
+                              mMergeRedundantAccesses(mergeRedundantAccesses),
+                              mHoistLoopAccesses(hoistLoopAccesses),
+                              mGuardAccesses(guardAccesses),
+                              mSourceFileName(sourceFileName),
+                              mProgramName(programName),
+                              mArchitecture(arch),
+                              mModuleSuffix(modSuffix) {
   mAddressSpacePtr = initInstrumenter(programName, rompLibPath);
   mCheckAccessFunctions = getCheckAccessFuncs(mAddressSpacePtr);
   if (mCheckAccessFunctions.size() == 0)  {
@@ -32,6 +44,13 @@ InstrumentClient::InstrumentClient(
   if (!mCheckAccessFunctions[0]) {
       LOG(FATAL) << "error empty first mCheckAccessFunctions element";
   }
+  if (mHoistLoopAccesses) {
+    mBeginLoopAccessFunction = getRompFunction(mAddressSpacePtr, "beginLoopAccess");
+    mEndLoopAccessFunction = getRompFunction(mAddressSpacePtr, "endLoopAccess");
+  }
+  if (mGuardAccesses) {
+    mNumActiveParallelRegions = getRompVariable(mAddressSpacePtr, "gNumActiveParallelRegions");
+  }
   LOG(INFO) << "InstrumentClient initialized with arch: " << mArchitecture;
 }
 
@@ -75,6 +94,43 @@ InstrumentClient::getCheckAccessFuncs(
   return checkAccessFuncs;
 }
 
+/*
+ * Get the dyninst representation of a function defined in romp library.
+ */
+BPatch_function*
+InstrumentClient::getRompFunction(
+      const unique_ptr<BPatch_addressSpace>& addrSpacePtr,
+      const string& functionName) {
+  auto appImage = addrSpacePtr->getImage();
+  if (!appImage) {
+    LOG(FATAL) << "cannot get image";
+  }
+  vector<BPatch_function*> functions;
+  appImage->findFunction(functionName.c_str(), functions);
+  if (functions.size() == 0 || !functions[0]) {
+    LOG(FATAL) << "cannot find function `" << functionName << "` in romp lib";
+  }
+  return functions[0];
+}
+
+/*
+ * Get the dyninst representation of a global variable defined in romp library.
+ */
+BPatch_variableExpr*
+InstrumentClient::getRompVariable(
+      const unique_ptr<BPatch_addressSpace>& addrSpacePtr,
+      const string& variableName) {
+  auto appImage = addrSpacePtr->getImage();
+  if (!appImage) {
+    LOG(FATAL) << "cannot get image";
+  }
+  auto variable = appImage->findVariable(variableName.c_str());
+  if (!variable) {
+    LOG(FATAL) << "cannot find variable `" << variableName << "` in romp lib";
+  }
+  return variable;
+}
+
 /* 
  * Get dyninst representation of all all functions in the 
  * program being instrumented. Ideally, no function should 
@@ -131,6 +187,7 @@ InstrumentClient::instrumentMemoryAccessInternal(
   opcodes.insert(BPatch_opLoad);
   opcodes.insert(BPatch_opStore);
   addrSpacePtr->beginInsertionSet();
+  InstrumentationStats totalStats;
   for (const auto& function : funcVec) {
     auto pointsVecPtr = function->findPoint(opcodes);
     if (!pointsVecPtr) {
@@ -141,8 +198,21 @@ InstrumentClient::instrumentMemoryAccessInternal(
           << function->getName();
       continue;
     }
-    insertSnippet(addrSpacePtr, pointsVecPtr);
+    auto usesFramePointer = false;
+    auto filterStackAccesses = mFilterStackAccesses && !isStackFrameAddressTaken(function, usesFramePointer);
+    InstrumentationStats stats;
+    insertSnippet(addrSpacePtr, function, pointsVecPtr, filterStackAccesses, usesFramePointer, stats);
+    LOG(INFO) << "function " << function->getName() << ": instrumented " << stats.numInstrumented 
+              << " accesses, filtered " << stats.numFiltered << " stack accesses, merged " 
+              << stats.numMerged << " redundant accesses, hoisted " << stats.numHoisted << " loop accesses";
+    totalStats.numInstrumented += stats.numInstrumented;
+    totalStats.numFiltered += stats.numFiltered;
+    totalStats.numMerged += stats.numMerged;
+    totalStats.numHoisted += stats.numHoisted;
   }
+  LOG(INFO) << "instrumented " << totalStats.numInstrumented << " accesses, filtered " << totalStats.numFiltered 
+            << " stack accesses, merged " << totalStats.numMerged << " redundant accesses, hoisted " 
+            << totalStats.numHoisted << " loop accesses";
   if (!addrSpacePtr->finalizeInsertionSet(true)) {
     LOG(FATAL) << "error in batch insertion of snippets";
   }
@@ -178,16 +248,557 @@ bool InstrumentClient::isThreadLocalStorageAccess(const InstructionAPI::Instruct
   return false; 
 }
 
+bool InstrumentClient::isStackRegister(const InstructionAPI::RegisterAST::Ptr& reg, bool usesFramePointer) {
+  auto name = reg->getID().name();
+  return name == "x86_64::rsp" || (usesFramePointer && name == "x86_64::rbp");
+}
+
+/*
+ * Return true if the instruction computes an address from the stack or frame
+ * pointer into another register or into memory, e.g., `lea rdi, [rbp-0x10]` 
+ * or `mov rax, rsp`. Registers used to address a memory operand, and the 
+ * stack pointer maintained by push, pop, call and return are not counted.
+ */
+bool InstrumentClient::takesStackAddress(const InstructionAPI::Instruction& instruction) {
+  auto category = instruction.getCategory();
+  if (category == InstructionAPI::c_CallInsn || category == InstructionAPI::c_ReturnInsn) {
+    return false;
+  }
+  auto operationId = instruction.getOperation().getID();
+  if (operationId == e_push || operationId == e_pop || operationId == e_leave || operationId == e_enter) {
+    return false;
+  }
+  vector<InstructionAPI::Operand> operands;
+  instruction.getOperands(operands);
+  auto readsStackValue = false;
+  auto writesOther = false;
+  for (const auto& operand : operands) {
+    auto isMemoryOperand = operand.readsMemory() || operand.writesMemory();
+    if (operand.isRead() && !isMemoryOperand) {
+      std::set<InstructionAPI::RegisterAST::Ptr> regsRead;
+      operand.getReadSet(regsRead);
+      for (const auto& reg : regsRead) {
+        readsStackValue |= isStackRegister(reg, true);
+      }
+    }
+    if (operand.isWritten()) {
+      if (isMemoryOperand) {
+        writesOther = true;
+        continue;
+      } 
+      std::set<InstructionAPI::RegisterAST::Ptr> regsWritten;
+      operand.getWriteSet(regsWritten);
+      for (const auto& reg : regsWritten) {
+        writesOther |= !isStackRegister(reg, true);
+      }
+    }
+  }
+  return readsStackValue && writesOther;
+}
+
+// return true for `mov rbp, rsp` in the prologue of a function with frame pointer
+bool InstrumentClient::setsFramePointer(const InstructionAPI::Instruction& instruction) {
+  if (instruction.getOperation().getID() != e_mov) {
+    return false;
+  }
+  vector<InstructionAPI::Operand> operands;
+  instruction.getOperands(operands);
+  if (operands.size() != 2) {
+    return false;
+  }
+  std::set<InstructionAPI::RegisterAST::Ptr> regsWritten;
+  std::set<InstructionAPI::RegisterAST::Ptr> regsRead;
+  operands[0].getWriteSet(regsWritten);
+  operands[1].getReadSet(regsRead);
+  return regsWritten.size() == 1 && (*regsWritten.begin())->getID().name() == "x86_64::rbp" &&
+         regsRead.size() == 1 && (*regsRead.begin())->getID().name() == "x86_64::rsp";
+}
+
+/*
+ * Scan the instructions of the function. Return true if the address of its 
+ * stack frame may escape, i.e., some instruction takes a stack address. 
+ * Otherwise, stack relative accesses of the function only touch locals of 
+ * the current task that no other task could refer to. `usesFramePointer` is 
+ * set if rbp holds the frame pointer, otherwise rbp is a general register.
+ */
+bool InstrumentClient::isStackFrameAddressTaken(BPatch_function* function, bool& usesFramePointer) {
+  usesFramePointer = false;
+  auto cfg = function->getCFG();
+  if (!cfg) {
+    return true;
+  }
+  std::set<BPatch_basicBlock*> blocks;
+  cfg->getAllBasicBlocks(blocks);
+  for (const auto& block : blocks) {
+    vector<InstructionAPI::Instruction> instructions;
+    if (!block->getInstructions(instructions)) {
+      return true;
+    }
+    for (const auto& instruction : instructions) {
+      if (setsFramePointer(instruction)) {
+        usesFramePointer = true;
+        continue;
+      }
+      if (takesStackAddress(instruction)) {
+        return true;
+      }
+    }
+  }
+  return false;
+}
+
+/*
+ * Return true if every memory operand of the instruction is addressed with
+ * the stack pointer, or the frame pointer, and constant offsets only. The
+ * implicit stack slot of push and pop is such an operand, while an explicit
+ * memory operand such as in `push qword ptr [rax]` is checked like any other.
+ */
+bool InstrumentClient::isStackRelativeAccess(const InstructionAPI::Instruction& instruction, bool usesFramePointer) {
+  auto operationId = instruction.getOperation().getID();
+  auto isPushOrPop = operationId == e_push || operationId == e_pop;
+  vector<InstructionAPI::Operand> operands;
+  instruction.getOperands(operands);
+  auto numMemoryOperands = 0;
+  for (const auto& operand : operands) {
+    if (!operand.readsMemory() && !operand.writesMemory()) {
+      continue;
+    }
+    numMemoryOperands++;
+    std::set<InstructionAPI::RegisterAST::Ptr> addressRegs;
+    operand.getReadSet(addressRegs);
+    if (addressRegs.empty()) {
+      return false;
+    }
+    for (const auto& reg : addressRegs) {
+      if (!isStackRegister(reg, usesFramePointer)) {
+        return false;
+      }
+    }
+  }
+  // push and pop of a register or an immediate may not list the stack slot
+  return numMemoryOperands > 0 || isPushOrPop;
+}
+
+/*
+ * Return the key of the memory operand of an access: its address expression,
+ * its size and the access properties other than read or write. Accesses with
+ * the same key in a basic block touch the same memory while the registers of 
+ * the expression are not written. A rip relative operand is keyed by the 
+ * address it resolves to, since the same text at two instructions names two
+ * different addresses. Return an empty key if the instruction has no single
+ * memory operand.
+ */
+std::string InstrumentClient::getAccessKey(const InstructionAPI::Instruction& instruction, Address instructionAddress, 
+                                           const AccessPoint& accessPoint, std::set<std::string>& addressRegNames) {
+  vector<InstructionAPI::Operand> operands;
+  instruction.getOperands(operands);
+  std::string key;
+  for (const auto& operand : operands) {
+    if (!operand.readsMemory() && !operand.writesMemory()) {
+      continue;
+    }
+    if (!key.empty()) {
+      return std::string();
+    }
+    auto value = operand.getValue();
+    auto addressText = value->format();
+    std::set<InstructionAPI::RegisterAST::Ptr> addressRegs;
+    operand.getReadSet(addressRegs);
+    for (const auto& reg : addressRegs) {
+      if (!reg->getID().isPC()) {
+        // a write to any part of the register changes the address
+        addressRegNames.insert(reg->getID().getBaseRegister().name());
+        continue;
+      }
+      if (addressRegs.size() != 1) {
+        return std::string();
+      }
+      // rip points to the next instruction when the operand is evaluated
+      std::set<InstructionAPI::Expression::Ptr> addressExpressions;
+      operand.addEffectiveReadAddresses(addressExpressions);
+      operand.addEffectiveWriteAddresses(addressExpressions);
+      if (addressExpressions.size() != 1) {
+        return std::string();
+      }
+      auto addressExpression = *addressExpressions.begin();
+      auto nextInstructionAddress = instructionAddress + instruction.size();
+      if (!addressExpression->bind(reg.get(), InstructionAPI::Result(InstructionAPI::u64, nextInstructionAddress))) {
+        return std::string();
+      }
+      auto result = addressExpression->eval();
+      if (!result.defined) {
+        return std::string();
+      }
+      addressText = "@" + std::to_string(result.convert<uint64_t>());
+    }
+    key = addressText + "/" + std::to_string(value->size()) + "/" + 
+          std::to_string(accessPoint.hasHardwareLock) + std::to_string(accessPoint.isTLSAccess);
+  }
+  return key;
+}
+
+/*
+ * Within a basic block, an access to the same address expression as an 
+ * earlier access is redundant if no instruction in between writes a register
+ * of the expression. One access is checked for all of them: the first write
+ * if any of them writes, so that a race is reported at the writing 
+ * instruction, and the first access otherwise. Calls end a basic block, so 
+ * no synchronization happens in between. Return the number of redundant 
+ * accesses.
+ */
+int InstrumentClient::mergeRedundantAccesses(BPatch_function* function, vector<AccessPoint>& accessPoints) {
+  auto cfg = function->getCFG();
+  if (!cfg) {
+    return 0;
+  }
+  std::unordered_map<Address, size_t> accessIndices;
+  for (size_t i = 0; i < accessPoints.size(); ++i) {
+    if (!accessPoints[i].isHoisted) {
+      accessIndices[reinterpret_cast<Address>(accessPoints[i].point->getAddress())] = i;
+    }
+  }
+  auto numRedundant = 0;
+  std::set<BPatch_basicBlock*> blocks;
+  cfg->getAllBasicBlocks(blocks);
+  for (const auto& block : blocks) {
+    vector<std::pair<InstructionAPI::Instruction, Address> > instructions;
+    if (!block->getInstructions(instructions)) {
+      continue;
+    }
+    // address expressions checked so far, with the registers they read
+    std::unordered_map<std::string, std::pair<size_t, std::set<std::string> > > checkedAccesses;
+    for (const auto& item : instructions) {
+      const auto& instruction = item.first;
+      auto it = accessIndices.find(item.second);
+      if (it != accessIndices.end()) {
+        auto& accessPoint = accessPoints[it->second];
+        std::set<std::string> addressRegNames;
+        auto key = getAccessKey(instruction, item.second, accessPoint, addressRegNames);
+        if (!key.empty()) {
+          auto checked = checkedAccesses.find(key);
+          if (checked != checkedAccesses.end()) {
+            auto& checkedPoint = accessPoints[checked->second.first];
+            if (accessPoint.isWrite && !checkedPoint.isWrite) {
+              checkedPoint.isRedundant = true;
+              checked->second.first = it->second;
+            } else {
+              accessPoint.isRedundant = true;
+            }
+            numRedundant++;
+          } else {
+            checkedAccesses[key] = std::make_pair(it->second, addressRegNames);
+          }
+        }
+      }
+      if (checkedAccesses.empty()) {
+        continue;
+      }
+      std::set<InstructionAPI::RegisterAST::Ptr> regsWritten;
+      instruction.getWriteSet(regsWritten);
+      for (const auto& reg : regsWritten) {
+        auto name = reg->getID().getBaseRegister().name();
+        for (auto checked = checkedAccesses.begin(); checked != checkedAccesses.end();) {
+          if (checked->second.second.count(name) > 0) {
+            checked = checkedAccesses.erase(checked);
+          } else {
+            checked++;
+          }
+        }
+      }
+    }
+  }
+  return numRedundant;
+}
+
+/*
+ * Return true if the only memory operand of the instruction is addressed 
+ * with one unscaled general register and a constant displacement.
+ */
+bool InstrumentClient::getBaseDisplacement(const InstructionAPI::Instruction& instruction, MachRegister& baseRegister, 
+                                           int64_t& displacement, uint32_t& bytesAccessed) {
+  vector<InstructionAPI::Operand> operands;
+  instruction.getOperands(operands);
+  auto numMemoryOperands = 0;
+  for (const auto& operand : operands) {
+    if (!operand.readsMemory() && !operand.writesMemory()) {
+      continue;
+    }
+    if (++numMemoryOperands > 1) {
+      return false;
+    }
+    std::set<InstructionAPI::Expression::Ptr> addressExpressions;
+    operand.addEffectiveReadAddresses(addressExpressions);
+    operand.addEffectiveWriteAddresses(addressExpressions);
+    if (addressExpressions.size() != 1) {
+      return false;
+    }
+    auto addressExpression = *addressExpressions.begin();
+    std::set<InstructionAPI::RegisterAST::Ptr> addressRegs;
+    operand.getReadSet(addressRegs);
+    if (addressRegs.size() != 1) {
+      return false;
+    }
+    auto reg = *addressRegs.begin();
+    baseRegister = reg->getID();
+    if (baseRegister.getBaseRegister() != baseRegister || baseRegister.name() == "x86_64::rip" || 
+        baseRegister.name() == "x86_64::rsp" || baseRegister.name() == "x86_64::rbp") {
+      return false;
+    }
+    // the displacement is the address with the base register bound to 0
+    if (!addressExpression->bind(reg.get(), InstructionAPI::Result(InstructionAPI::u64, 0))) {
+      return false;
+    }
+    auto result = addressExpression->eval();
+    if (!result.defined) {
+      return false;
+    }
+    displacement = result.convert<int64_t>();
+    // reject a scaled index, [reg * scale + disp] does not advance with reg
+    if (!addressExpression->bind(reg.get(), InstructionAPI::Result(InstructionAPI::u64, 1))) {
+      return false;
+    }
+    result = addressExpression->eval();
+    if (!result.defined || result.convert<int64_t>() - displacement != 1) {
+      return false;
+    }
+    bytesAccessed = operand.getValue()->size();
+  }
+  return numMemoryOperands == 1;
+}
+
+/*
+ * Return true if the instruction adds a constant to the register it writes:
+ * add, sub, inc, dec or lea of the register itself.
+ */
+bool InstrumentClient::getConstantIncrement(const InstructionAPI::Instruction& instruction, int64_t& increment) {
+  auto operationId = instruction.getOperation().getID();
+  vector<InstructionAPI::Operand> operands;
+  instruction.getOperands(operands);
+  if (operands.empty() || operands[0].readsMemory() || operands[0].writesMemory()) {
+    return false;
+  }
+  std::set<InstructionAPI::RegisterAST::Ptr> regsWritten;
+  operands[0].getWriteSet(regsWritten);
+  if (regsWritten.size() != 1) {
+    return false;
+  }
+  auto reg = *regsWritten.begin();
+  if (reg->getID().getBaseRegister() != reg->getID()) {
+    // a write to a sub register does not advance the full register
+    return false;
+  }
+  switch (operationId) {
+    case e_inc:
+      increment = 1;
+      return operands.size() == 1;
+    case e_dec:
+      increment = -1;
+      return operands.size() == 1;
+    case e_add:
+    case e_sub:
+    {
+      if (operands.size() != 2) {
+        return false;
+      }
+      auto immediate = dynamic_cast<InstructionAPI::Immediate*>(operands[1].getValue().get());
+      if (!immediate) {
+        return false;
+      }
+      increment = immediate->eval().convert<int64_t>();
+      if (operationId == e_sub) {
+        increment = -increment;
+      }
+      return true;
+    }
+    case e_lea:
+    {
+      if (operands.size() != 2) {
+        return false;
+      }
+      std::set<InstructionAPI::RegisterAST::Ptr> regsRead;
+      operands[1].getReadSet(regsRead);
+      if (regsRead.size() != 1 || (*regsRead.begin())->getID() != reg->getID()) {
+        return false;
+      }
+      auto expression = operands[1].getValue();
+      if (!expression->bind(reg.get(), InstructionAPI::Result(InstructionAPI::u64, 0))) {
+        return false;
+      }
+      auto result = expression->eval();
+      if (!result.defined) {
+        return false;
+      }
+      increment = result.convert<int64_t>();
+      return true;
+    }
+    default:
+      return false;
+  }
+}
+
+/*
+ * Hoist the checks of strided accesses out of innermost loops. An access 
+ * qualifies if the loop has no call or return, the access is addressed by 
+ * [reg + displacement], and reg is written in the loop only by one constant
+ * increment in the basic block of the access. Every execution of that block
+ * then accesses the next element, so the accessed range follows from the 
+ * value of reg when the loop is entered and when it exits. Return the 
+ * number of hoisted accesses.
+ */
+int InstrumentClient::hoistLoopAccesses(const unique_ptr<BPatch_addressSpace>& addrSpacePtr, BPatch_function* function, 
+                                        vector<AccessPoint>& accessPoints) {
+  auto cfg = function->getCFG();
+  if (!cfg) {
+    return 0;
+  }
+  BPatch_Vector<BPatch_basicBlockLoop*> loops;
+  if (!cfg->getLoops(loops)) {
+    return 0;
+  }
+  std::unordered_map<Address, size_t> accessIndices;
+  for (size_t i = 0; i < accessPoints.size(); ++i) {
+    accessIndices[reinterpret_cast<Address>(accessPoints[i].point->getAddress())] = i;
+  }
+  auto numHoisted = 0;
+  for (const auto& loop : loops) {
+    BPatch_Vector<BPatch_basicBlockLoop*> innerLoops;
+    loop->getContainedLoops(innerLoops);
+    if (!innerLoops.empty()) {
+      continue;
+    }
+    BPatch_Vector<BPatch_basicBlock*> loopBlocks;
+    loop->getLoopBasicBlocks(loopBlocks);
+    // the writes of every register in the loop, and the increment if it is the only write
+    std::unordered_map<std::string, int> numRegisterWrites;
+    std::unordered_map<std::string, std::pair<Address, int64_t> > registerIncrements;
+    std::unordered_map<std::string, BPatch_basicBlock*> registerIncrementBlocks;
+    vector<std::pair<BPatch_basicBlock*, vector<std::pair<InstructionAPI::Instruction, Address> > > > loopInstructions;
+    auto isCandidateLoop = true;
+    for (const auto& block : loopBlocks) {
+      vector<std::pair<InstructionAPI::Instruction, Address> > instructions;
+      if (!block->getInstructions(instructions)) {
+        isCandidateLoop = false;
+        break;
+      }
+      for (const auto& item : instructions) {
+        auto category = item.first.getCategory();
+        if (category == InstructionAPI::c_CallInsn || category == InstructionAPI::c_ReturnInsn) {
+          isCandidateLoop = false;
+          break;
+        }
+        std::set<InstructionAPI::RegisterAST::Ptr> regsWritten;
+        item.first.getWriteSet(regsWritten);
+        for (const auto& reg : regsWritten) {
+          auto name = reg->getID().getBaseRegister().name();
+          numRegisterWrites[name]++;
+          int64_t increment = 0;
+          if (getConstantIncrement(item.first, increment)) {
+            registerIncrements[name] = std::make_pair(item.second, increment);
+            registerIncrementBlocks[name] = block;
+          }
+        }
+      }
+      if (!isCandidateLoop) {
+        break;
+      }
+      loopInstructions.push_back(std::make_pair(block, instructions));
+    }
+    if (!isCandidateLoop) {
+      continue;
+    }
+    vector<LoopAccessPoint> loopAccessPoints;
+    for (const auto& blockInstructions : loopInstructions) {
+      for (const auto& item : blockInstructions.second) {
+        auto it = accessIndices.find(item.second);
+        if (it == accessIndices.end() || loopAccessPoints.size() == LOOP_ACCESS_SLOTS) {
+          continue;
+        }
+        MachRegister baseRegister;
+        int64_t displacement = 0;
+        uint32_t bytesAccessed = 0;
+        if (!getBaseDisplacement(item.first, baseRegister, displacement, bytesAccessed)) {
+          continue;
+        }
+        auto name = baseRegister.name();
+        auto increment = registerIncrements.find(name);
+        if (numRegisterWrites[name] != 1 || increment == registerIncrements.end() || 
+            registerIncrementBlocks[name] != blockInstructions.first || increment->second.second == 0) {
+          continue;
+        }
+        auto stride = increment->second.second;
+        // instructions of a basic block are laid out in order
+        auto offset = item.second > increment->second.first ? displacement + stride : displacement;
+        loopAccessPoints.push_back(LoopAccessPoint{it->second, baseRegister, offset, stride, bytesAccessed});
+      }
+    }
+    if (loopAccessPoints.empty()) {
+      continue;
+    }
+    insertLoopAccessSnippets(addrSpacePtr, cfg, loop, loopAccessPoints, accessPoints);
+    for (const auto& loopAccessPoint : loopAccessPoints) {
+      numHoisted += accessPoints[loopAccessPoint.accessIndex].isHoisted ? 1 : 0;
+    }
+  }
+  return numHoisted;
+}
+
+/*
+ * Save the address registers when the loop is entered, and check the ranges
+ * accessed when the loop exits. The accesses stay instrumented one by one if
+ * the loop has no entry or exit points.
+ */
+void InstrumentClient::insertLoopAccessSnippets(const unique_ptr<BPatch_addressSpace>& addrSpacePtr, BPatch_flowGraph* cfg, 
+                                                BPatch_basicBlockLoop* loop, const vector<LoopAccessPoint>& loopAccessPoints, 
+                                                vector<AccessPoint>& accessPoints) {
+  auto entryPoints = cfg->findLoopInstPoints(BPatch_locLoopEntry, loop);
+  auto exitPoints = cfg->findLoopInstPoints(BPatch_locLoopExit, loop);
+  if (!entryPoints || entryPoints->empty() || !exitPoints || exitPoints->empty()) {
+    return;
+  }
+  for (uint32_t slot = 0; slot < loopAccessPoints.size(); ++slot) {
+    const auto& loopAccessPoint = loopAccessPoints[slot];
+    auto& accessPoint = accessPoints[loopAccessPoint.accessIndex];
+    vector<BPatch_snippet*> beginArgs;
+    beginArgs.push_back(new BPatch_constExpr(slot));
+    beginArgs.push_back(new BPatch_registerExpr(loopAccessPoint.baseRegister));
+    beginArgs.push_back(new BPatch_constExpr(loopAccessPoint.offset));
+    beginArgs.push_back(new BPatch_constExpr(loopAccessPoint.stride));
+    BPatch_funcCallExpr beginCall(*mBeginLoopAccessFunction, beginArgs);
+    vector<BPatch_snippet*> endArgs;
+    endArgs.push_back(new BPatch_constExpr(slot));
+    endArgs.push_back(new BPatch_registerExpr(loopAccessPoint.baseRegister));
+    endArgs.push_back(new BPatch_constExpr(loopAccessPoint.bytesAccessed));
+    endArgs.push_back(new BPatch_constExpr(accessPoint.point->getAddress()));
+    // access flags defined in AccessBatch.h
+    uint32_t flags = (accessPoint.isWrite ? 0x1 : 0) | (accessPoint.hasHardwareLock ? 0x2 : 0) | (accessPoint.isTLSAccess ? 0x4 : 0);
+    endArgs.push_back(new BPatch_constExpr(flags));
+    BPatch_funcCallExpr endCall(*mEndLoopAccessFunction, endArgs);
+    if (!addrSpacePtr->insertSnippet(beginCall, *entryPoints, BPatch_callBefore) ||
+        !addrSpacePtr->insertSnippet(endCall, *exitPoints, BPatch_callBefore)) {
+      LOG(FATAL) << "snippet insertion failed";
+    }
+    accessPoint.isHoisted = true;
+  }
+}
+
 /*
- * Insert checkAccess code snippet to load/store point
+ * Insert checkAccess code snippet to load/store point. If the function never
+ * takes the address of its stack frame, stack relative accesses are private
+ * to the task and not instrumented. Redundant accesses in a basic block are 
+ * checked once.
  */
 void
 InstrumentClient::insertSnippet(
         const unique_ptr<BPatch_addressSpace>& addrSpacePtr,
-        const vector<BPatch_point*>* pointsVecPtr) {
+        BPatch_function* function,
+        const vector<BPatch_point*>* pointsVecPtr,
+        bool filterStackAccesses,
+        bool usesFramePointer,
+        InstrumentationStats& stats) {
   if (!pointsVecPtr) {
     LOG(FATAL) << "null pointer";
   } 
+  vector<AccessPoint> accessPoints;
   for (const auto& point : *pointsVecPtr) {
     auto memoryAccess = point->getMemoryAccess();
     if (!memoryAccess) {
@@ -219,9 +830,28 @@ InstrumentClient::insertSnippet(
     if (isCallInstruction(instruction)) {
       continue;
     }
+    if (filterStackAccesses && isStackRelativeAccess(instruction, usesFramePointer)) {
+      stats.numFiltered++;
+      continue;
+    }
     auto isTLSAccess = isThreadLocalStorageAccess(instruction);
     auto hardWareLock = hasHardwareLock(instruction, mArchitecture);
+    accessPoints.push_back(AccessPoint{point, isWrite, hardWareLock, isTLSAccess, false, false});
+  }
+  if (mHoistLoopAccesses) {
+    stats.numHoisted += hoistLoopAccesses(addrSpacePtr, function, accessPoints);
+  }
+  if (mMergeRedundantAccesses) {
+    stats.numMerged += mergeRedundantAccesses(function, accessPoints);
+  }
 
+  for (const auto& accessPoint : accessPoints) {
+    if (accessPoint.isRedundant || accessPoint.isHoisted) {
+      continue;
+    }
+    stats.numInstrumented++;
+    auto point = accessPoint.point;
+    auto instructionAddress = point->getAddress();         
     vector<BPatch_snippet*> funcArgs;
     // memory address 
     funcArgs.push_back(new BPatch_effectiveAddressExpr()); 
@@ -230,17 +860,37 @@ InstrumentClient::insertSnippet(
     // address of instruction
     funcArgs.push_back(new BPatch_constExpr(instructionAddress)); 
     // instruction contains hardware lock or not
-    funcArgs.push_back(new BPatch_constExpr(hardWareLock));
+    funcArgs.push_back(new BPatch_constExpr(accessPoint.hasHardwareLock));
     // is write access or not
-    funcArgs.push_back(new BPatch_constExpr(isWrite));
+    funcArgs.push_back(new BPatch_constExpr(accessPoint.isWrite));
     // is TLS access or not
-    funcArgs.push_back(new BPatch_constExpr(isTLSAccess));
+    funcArgs.push_back(new BPatch_constExpr(accessPoint.isTLSAccess));
     BPatch_funcCallExpr checkAccessCall(*(mCheckAccessFunctions[0]), funcArgs);
+    insertAccessSnippet(addrSpacePtr, checkAccessCall, point);
+  }
+}
 
-    if (!addrSpacePtr->insertSnippet(
-                checkAccessCall, *point, BPatch_callBefore)) {
-        LOG(FATAL) << "snippet insertion failed";
+/*
+ * Insert the call of an access point. If guarded, the call is made only 
+ * while some parallel region is active. The guard is a load and a compare 
+ * inlined at the point, so accesses in the sequential parts of the program
+ * skip the call and the register spills around it.
+ */
+void
+InstrumentClient::insertAccessSnippet(
+        const unique_ptr<BPatch_addressSpace>& addrSpacePtr,
+        const BPatch_snippet& snippet,
+        BPatch_point* point) {
+  if (!mGuardAccesses) {
+    if (!addrSpacePtr->insertSnippet(snippet, *point, BPatch_callBefore)) {
+      LOG(FATAL) << "snippet insertion failed";
     }
+    return;
+  }
+  BPatch_boolExpr isParallel(BPatch_ne, *mNumActiveParallelRegions, BPatch_constExpr(0));
+  BPatch_ifExpr guardedSnippet(isParallel, snippet);
+  if (!addrSpacePtr->insertSnippet(guardedSnippet, *point, BPatch_callBefore)) {
+    LOG(FATAL) << "snippet insertion failed";
   }
 }
 
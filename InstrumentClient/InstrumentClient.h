@@ -1,19 +1,51 @@
 #pragma once
 #include <memory>
+#include <set>
 #include <unordered_map>
 #include <string>
 #include <vector>
 
 #include "BPatch.h"
 #include "BPatch_addressSpace.h"
+#include "BPatch_basicBlock.h"
+#include "BPatch_basicBlockLoop.h"
+#include "BPatch_flowGraph.h"
 #include "BPatch_function.h"
 #include "BPatch_point.h"
 #include "BPatch_process.h"
 #include "Symtab.h"
 
 #define MODULE_NAME_LENGTH 128
+// number of accesses hoisted out of one loop, LOOP_ACCESS_SLOTS in AccessBatch.h
+#define LOOP_ACCESS_SLOTS 8
 
 namespace romp {
+  // a load or store point to be instrumented
+  typedef struct AccessPoint {
+    BPatch_point* point;
+    bool isWrite;
+    bool hasHardwareLock;
+    bool isTLSAccess;
+    bool isRedundant; // checked by an earlier access in the same basic block
+    bool isHoisted;   // checked as a range when the loop exits
+  } AccessPoint;
+
+  // an access addressed by [baseRegister + displacement]
+  typedef struct LoopAccessPoint {
+    size_t accessIndex;
+    Dyninst::MachRegister baseRegister;
+    int64_t offset;  // displacement, plus the stride if the access follows the increment
+    int64_t stride;
+    uint32_t bytesAccessed;
+  } LoopAccessPoint;
+
+  typedef struct InstrumentationStats {
+    int numInstrumented = 0;
+    int numFiltered = 0;
+    int numMerged = 0;
+    int numHoisted = 0;
+  } InstrumentationStats;
+
   class InstrumentClient {
     public:
       InstrumentClient(
@@ -22,17 +54,39 @@ namespace romp {
               const std::string& rompLibPath,
               std::shared_ptr<BPatch> bpatchPtr,
               const std::string& architecture,
-              const std::string& moduleSuffix);
+              const std::string& moduleSuffix,
+              bool filterStackAccesses,
+              bool mergeRedundantAccesses,
+              bool hoistLoopAccesses,
+              bool guardAccesses);
       void instrumentMemoryAccess();    
     private:
       std::unique_ptr<BPatch_addressSpace> initInstrumenter(const std::string& programName, const std::string& rompLibPath); 
       std::vector<BPatch_function*> getCheckAccessFuncs(const std::unique_ptr<BPatch_addressSpace>& addrSpacePtr);
+      BPatch_function* getRompFunction(const std::unique_ptr<BPatch_addressSpace>& addrSpacePtr, const std::string& functionName);
       std::vector<BPatch_function*> getFunctionsVector(const std::unique_ptr<BPatch_addressSpace>& addrSpacePtr); 
       void instrumentMemoryAccessInternal(const std::unique_ptr<BPatch_addressSpace>& addrSpacePtr, std::vector<BPatch_function*>& funcVec);
-      void insertSnippet(const std::unique_ptr<BPatch_addressSpace>& addrSpacePtr, const std::vector<BPatch_point*>* pointsVecPtr);
+      void insertSnippet(const std::unique_ptr<BPatch_addressSpace>& addrSpacePtr, BPatch_function* function, const std::vector<BPatch_point*>* pointsVecPtr,
+                         bool filterStackAccesses, bool usesFramePointer, InstrumentationStats& stats);
+      std::string getAccessKey(const Dyninst::InstructionAPI::Instruction& instruction, Dyninst::Address instructionAddress, 
+                               const AccessPoint& accessPoint, std::set<std::string>& addressRegNames);
+      int mergeRedundantAccesses(BPatch_function* function, std::vector<AccessPoint>& accessPoints);
+      bool getBaseDisplacement(const Dyninst::InstructionAPI::Instruction& instruction, Dyninst::MachRegister& baseRegister, 
+                               int64_t& displacement, uint32_t& bytesAccessed);
+      bool getConstantIncrement(const Dyninst::InstructionAPI::Instruction& instruction, int64_t& increment);
+      int hoistLoopAccesses(const std::unique_ptr<BPatch_addressSpace>& addrSpacePtr, BPatch_function* function, std::vector<AccessPoint>& accessPoints);
+      void insertLoopAccessSnippets(const std::unique_ptr<BPatch_addressSpace>& addrSpacePtr, BPatch_flowGraph* cfg, BPatch_basicBlockLoop* loop,
+                                    const std::vector<LoopAccessPoint>& loopAccessPoints, std::vector<AccessPoint>& accessPoints);
+      BPatch_variableExpr* getRompVariable(const std::unique_ptr<BPatch_addressSpace>& addrSpacePtr, const std::string& variableName);
+      void insertAccessSnippet(const std::unique_ptr<BPatch_addressSpace>& addrSpacePtr, const BPatch_snippet& snippet, BPatch_point* point);
       bool hasHardwareLock(const Dyninst::InstructionAPI::Instruction& instruction, const std::string& arch);
       bool isCallInstruction(const Dyninst::InstructionAPI::Instruction& instruction);
       bool isThreadLocalStorageAccess(const Dyninst::InstructionAPI::Instruction& instruction); 
+      bool isStackRegister(const Dyninst::InstructionAPI::RegisterAST::Ptr& reg, bool usesFramePointer);
+      bool takesStackAddress(const Dyninst::InstructionAPI::Instruction& instruction);
+      bool setsFramePointer(const Dyninst::InstructionAPI::Instruction& instruction);
+      bool isStackFrameAddressTaken(BPatch_function* function, bool& usesFramePointer);
+      bool isStackRelativeAccess(const Dyninst::InstructionAPI::Instruction& instruction, bool usesFramePointer);
       void finishInstrumentation(const std::unique_ptr<BPatch_addressSpace>& addrSpacePtr); 
       void findAllOmpDirectiveLineNumbers();
       void findInstructionRanges();
@@ -41,6 +95,13 @@ namespace romp {
       std::unique_ptr<BPatch_addressSpace> mAddressSpacePtr;
       std::shared_ptr<BPatch> mBpatchPtr;
       std::vector<BPatch_function*> mCheckAccessFunctions;
+      BPatch_function* mBeginLoopAccessFunction;
+      BPatch_function* mEndLoopAccessFunction;
+      BPatch_variableExpr* mNumActiveParallelRegions;
+      bool mFilterStackAccesses;
+      bool mMergeRedundantAccesses;
+      bool mHoistLoopAccesses;
+      bool mGuardAccesses;
       std::string mProgramName;
       std::string mSourceFileName;
       std::string mArchitecture;
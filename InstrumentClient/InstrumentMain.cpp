@@ -12,6 +12,10 @@ DEFINE_string(program, "", "program to be instrumented");
 DEFINE_string(source, "", "program source file");
 DEFINE_string(arch, "x86", "arch of the binary to be instrumented");
 DEFINE_string(modSuffix, ".inst", "suffix for name of instrumented binary");
+DEFINE_bool(filterStack, true, "skip stack accesses of functions that never take a stack address");
+DEFINE_bool(mergeAccesses, true, "check accesses to the same address in a basic block once");
+DEFINE_bool(hoistLoopAccesses, false, "check strided accesses of innermost loops as ranges at loop exit");
+DEFINE_bool(guardAccesses, true, "skip the check call of an access inline while no parallel region is active");
 
 int main(int argc, char* argv[]) {
   gflags::ParseCommandLineFlags(&argc, &argv, true);
@@ -31,7 +35,11 @@ int main(int argc, char* argv[]) {
                           string(envRompPath), 
                           bpatchPtr, 
                           FLAGS_arch,
-                          FLAGS_modSuffix));
+                          FLAGS_modSuffix,
+                          FLAGS_filterStack,
+                          FLAGS_mergeAccesses,
+                          FLAGS_hoistLoopAccesses,
+                          FLAGS_guardAccesses));
   client->instrumentMemoryAccess();
   return 0;
 }
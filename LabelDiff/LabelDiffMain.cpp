@@ -0,0 +1,114 @@
+#include <gflags/gflags.h>
+#include <glog/logging.h>
+#include <iostream>
+
+#include "Core.h"
+#include "Label.h"
+#include "RecordManagement.h"
+#include "TaskData.h"
+
+/*
+ * romp-label-diff decodes two task labels printed in their hex encoding by 
+ * romp's debug log and explains the happens-before decision between them.
+ * Explicit task dependences are recorded in the runtime and are not part of
+ * the label, so they are not taken into account here.
+ */
+using namespace std;
+
+DEFINE_string(hist, "", "hex encoding of the history access label");
+DEFINE_string(cur, "", "hex encoding of the current access label");
+
+const char* nodeRelationToString(NodeRelation nodeRelation) {
+  switch(nodeRelation) {
+    case eSiblingParallel:
+      return "sibling parallel";
+    case eNonSiblingParallel:
+      return "non-sibling parallel";
+    case eHappensBefore:
+      return "happens before";
+    case eSameNode:
+      return "same node";
+    default:
+      return "undefined";
+  }
+}
+
+const char* segmentTypeToString(SegmentType segmentType) {
+  switch(segmentType) {
+    case eImplicit:
+      return "implicit task";
+    case eExplicit:
+      return "explicit task";
+    case eLogical:
+      return "workshare";
+    default:
+      return "error";
+  }
+}
+
+void explainDiffSegment(Label* histLabel, Label* curLabel, int diffIndex) {
+  auto histSegment = histLabel->getKthSegment(diffIndex);
+  auto curSegment = curLabel->getKthSegment(diffIndex);
+  uint64_t histOffset, histSpan, curOffset, curSpan;
+  histSegment->getOffsetSpan(histOffset, histSpan);
+  curSegment->getOffsetSpan(curOffset, curSpan);
+  cout << "labels diverge at segment " << diffIndex << endl;
+  cout << "  hist: " << histSegment->toFieldsBreakdown() << endl;
+  cout << "  cur:  " << curSegment->toFieldsBreakdown() << endl;
+  if (histSpan != curSpan) {
+    cout << "span differs, the labels do not come from the same team" << endl;
+  } else if (histSpan == 1) {
+    cout << "span is 1, segments are of type " << segmentTypeToString(histSegment->getType())
+         << ", decided by the rules of that segment type" << endl;
+  } else if (histOffset != curOffset && histOffset % histSpan == curOffset % histSpan) {
+    cout << "same implicit task " << histOffset % histSpan << " in different barrier phases" << endl;
+  } else if (histOffset != curOffset) {
+    cout << "sibling implicit tasks " << histOffset % histSpan << " and " << curOffset % histSpan 
+         << ", ordered only through ordered sections" << endl;
+  } else {
+    cout << "same task at different synchronization points" << endl;
+  }
+}
+
+int main(int argc, char* argv[]) {
+  gflags::ParseCommandLineFlags(&argc, &argv, true);
+  FLAGS_alsologtostderr = 1;
+  google::InitGoogleLogging(argv[0]);
+  if (FLAGS_hist == "" || FLAGS_cur == "") {
+    LOG(FATAL) << "both --hist and --cur labels should be specified";
+  }
+  auto histLabel = decodeLabelFromHex(FLAGS_hist);
+  if (!histLabel) {
+    LOG(FATAL) << "cannot decode history label: " << FLAGS_hist;
+  }
+  auto curLabel = decodeLabelFromHex(FLAGS_cur);
+  if (!curLabel) {
+    LOG(FATAL) << "cannot decode current label: " << FLAGS_cur;
+  }
+  cout << "hist label: " << histLabel->toString() << endl << "  " << histLabel->toFieldsBreakdown();
+  cout << "cur label:  " << curLabel->toString() << endl << "  " << curLabel->toFieldsBreakdown();
+  auto diffIndex = compareLabels(histLabel.get(), curLabel.get());
+  switch(diffIndex) {
+    case static_cast<int>(eSameLabel):
+      cout << "labels are identical" << endl;
+      break;
+    case static_cast<int>(eLeftIsPrefix):
+      cout << "hist label is a prefix of cur label, cur task is a descendant of hist task" << endl;
+      break;
+    case static_cast<int>(eRightIsPrefix):
+      cout << "cur label is a prefix of hist label, cur access happens before hist access" << endl;
+      return 0;
+    default:
+      explainDiffSegment(histLabel.get(), curLabel.get(), diffIndex);
+      break;
+  }
+  // both tasks are treated as implicit tasks and no parallel region data is
+  // passed, so that explicit task dependences are not consulted
+  TaskData histTaskData, curTaskData;
+  RecordManagementInfo recordManagementInfo;
+  recordManagementInfo.nodeRelation = eUndefinedNodeRelation;
+  auto isHappensBefore = happensBefore(histLabel.get(), curLabel.get(), diffIndex, &histTaskData, &curTaskData, nullptr, recordManagementInfo);
+  cout << "node relation: " << nodeRelationToString(recordManagementInfo.nodeRelation) << endl;
+  cout << "hist happens before cur: " << (isHappensBefore ? "yes" : "no") << endl;
+  return 0;
+}
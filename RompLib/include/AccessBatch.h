@@ -0,0 +1,41 @@
+#pragma once
+#include <cstdint>
+
+/*
+ * Memory accesses could be checked in batches instead of one `checkAccess`
+ * call per access. `checkAccessBatch` checks an array of access descriptors
+ * with one runtime context lookup, so all of them must have been issued by
+ * the calling thread in the same task, with no synchronization in between.
+ * The instrumenter does not emit batches: a Dyninst snippet cannot append
+ * to a thread local buffer without calling into the library, which would
+ * cost as much as the check it defers.
+ *
+ * Strided accesses in loops are checked as ranges. `checkAccessRange` checks
+ * `count` accesses `stride` bytes apart with one runtime context lookup. For
+ * an access addressed by a register that the loop advances by a constant, 
+ * `beginLoopAccess` saves the register value when the loop is entered, and 
+ * `endLoopAccess` checks every element accessed when the loop exits. The 
+ * loop has no calls, so at most one such loop runs on a thread at a time 
+ * and the instrumenter assigns each hoisted access of the loop a slot.
+ */
+
+#define LOOP_ACCESS_SLOTS 8
+
+typedef enum AccessFlag {
+  eAccessIsWrite = 0x1,
+  eAccessHasHardwareLock = 0x2,
+  eAccessIsTLS = 0x4,
+} AccessFlag;
+
+typedef struct AccessDesc {
+  void* baseAddress;
+  uint32_t bytesAccessed;
+  uint32_t flags;
+  void* instnAddr;
+} AccessDesc;
+
+typedef struct LoopAccess {
+  uint64_t entryValue; // value of the address register when the loop is entered
+  int64_t offset;      // address of the first access relative to entryValue
+  int64_t stride;      // change of the address register in every iteration
+} LoopAccess;
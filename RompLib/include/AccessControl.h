@@ -1,4 +1,6 @@
 #pragma once
+#include <atomic>
+
 #include "pfq-rwlock.h"
 #include "PerformanceCounters.h"
 
@@ -13,7 +15,7 @@ private:
 
 class ReaderWriterLockGuard {
 public:
-  ReaderWriterLockGuard(pfq_rwlock_t* lock, pfq_rwlock_node_t* node, PerformanceCounters* performanceCounters);
+  ReaderWriterLockGuard(pfq_rwlock_t* lock, pfq_rwlock_node_t* node, PerformanceCounters* performanceCounters, std::atomic_uint64_t* contentionCounter = nullptr);
   ~ReaderWriterLockGuard();
   bool upgradeFromReaderToWriter();
 private:
@@ -21,4 +23,5 @@ private:
   pfq_rwlock_node_t* mNode;
   bool mWriteLockAcquired;
   PerformanceCounters* mPerformanceCounters;
+  std::atomic_uint64_t* mContentionCounter; // bumped when the lock is found contended
 };
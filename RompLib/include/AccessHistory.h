@@ -1,4 +1,5 @@
 #pragma once
+#include <atomic>
 #include <cstdint>
 #include <memory>
 #include <vector>
@@ -15,6 +16,7 @@ class AccessHistory {
 public: 
   AccessHistory(); 
   pfq_rwlock_t& getLock();
+  std::atomic_uint64_t* getLockContentionCounter();
   std::vector<Record>* getRecords();
   void setFlag(AccessHistoryFlag flag);
   void setOwner(void* owner);
@@ -23,16 +25,21 @@ public:
   void clearFlag(AccessHistoryFlag flag);
   void addRecordToAccessHistory(const Record& record);
   void removeRecords(const std::vector<int>& recordsToBeRemoved);
+  void compactRecordLabels();
   bool dataRaceFound() const;
   bool memIsRecycled() const;
   bool hasRecords() const;
   uint8_t getState() const;
   uint8_t getRecordState() const;
   uint64_t getNumRecords() const;
+  uint32_t getVersion() const;
   void* getOwner() const;
 private:
+#ifndef STRIPED_SHADOW_LOCKS
   pfq_rwlock_t mLock; 
+#endif
   uint8_t mState;  
+  uint32_t mVersion; // bumped whenever records or owner change, under the writer lock
   std::unique_ptr<std::vector<Record>> mRecords; 
   void* mOwner;  // if the memory address is for a stack-allocated variable, record its owner.
 };
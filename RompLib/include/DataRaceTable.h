@@ -0,0 +1,43 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "CoreUtil.h"
+
+#define DATA_RACE_TABLE_DEFAULT_CAPACITY 1024
+
+typedef enum DataRaceEntryState {
+  eEntryEmpty = 0,
+  eEntryWriting = 1,
+  eEntryPublished = 2,
+} DataRaceEntryState;
+
+typedef struct DataRaceEntry {
+  std::atomic_uint64_t state;
+  DataRaceInfo info;
+} DataRaceEntry;
+
+/*
+ * DataRaceTable collects the data races found during the execution. A data 
+ * race is identified by the pair of racing instructions regardless of their
+ * order, the same pair found on other memory locations or found again later
+ * is not recorded twice. Recording is lock free: an entry is claimed with 
+ * compare and swap and published once its info is written. The table has a 
+ * fixed capacity rounded up to a power of two, which could be set with 
+ * ROMP_MAX_DATA_RACES. Data races found after the table is full are only 
+ * counted.
+ */
+class DataRaceTable {
+public:
+  DataRaceTable() : mCapacity(0), mNumDroppedDataRaces(0) {}
+  void init(uint64_t capacity);
+  bool recordDataRace(void* instnAddrPrev, void* instnAddrCur, uint64_t memAddr);
+  std::vector<DataRaceInfo> getDataRaces() const;
+  uint64_t getNumDroppedDataRaces() const;
+private:
+  std::unique_ptr<DataRaceEntry[]> mEntries;
+  uint64_t mCapacity;
+  std::atomic_uint64_t mNumDroppedDataRaces;
+};
@@ -20,8 +20,8 @@ enum DataSharingType {
   eInitialThread = 7, 
 };
 
-bool shouldCheckMemoryAccess(const ThreadInfo& threadInfo, const TaskMemoryInfo& taskMemoryInfo, const TaskInfo& taskInfo, const uint64_t memoryAddress, const ompt_frame_t* taskFrame, DataSharingType& dataSharingType, const bool isWrite, void* instructionAddress);
-DataSharingType analyzeDataSharingType(const ThreadInfo& threadInfo, const TaskMemoryInfo& taskMemoryInfo, const uint64_t memoryAddress, const ompt_frame_t* taskFrame);
+bool shouldCheckMemoryAccess(const ThreadInfo& threadInfo, const TaskAddressBounds& taskAddressBounds, const TaskInfo& taskInfo, const uint64_t memoryAddress, DataSharingType& dataSharingType, const bool isWrite, void* instructionAddress);
+DataSharingType analyzeDataSharingType(const ThreadInfo& threadInfo, const TaskAddressBounds& taskAddressBounds, const uint64_t memoryAddress);
 bool isDuplicateMemoryAccess(const uint64_t memoryAddress, const TaskInfo& taskInfo, bool isWrite);
 void recycleTaskThreadStackMemory(void* taskData);
 void recycleTaskPrivateMemory();
@@ -0,0 +1,72 @@
+#pragma once
+#include <algorithm>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+/*
+ * This header file declares an epoch based reclamation scheme for objects 
+ * which are read without locks. A reader dereferences shared objects inside
+ * an EpochReadGuard, which announces the global reclamation epoch for the
+ * calling thread. A writer first unpublishes an object, then retires it to
+ * a RetireList. Retired objects are tagged with the global epoch, which is
+ * advanced at the same time, and are freed once no reader announced an
+ * epoch that is not newer than the tag.
+ *
+ * Read sections must not be nested. Writers of one RetireList are expected
+ * to be serialized by the caller.
+ */
+class EpochReadGuard {
+public:
+  EpochReadGuard();
+  ~EpochReadGuard();
+};
+
+// advance the global epoch, return the epoch before advancing
+uint64_t advanceReclamationEpoch();
+// return the oldest epoch announced by an active reader, UINT64_MAX if none
+uint64_t getOldestActiveReclamationEpoch();
+
+template<typename T>
+class RetireList {
+public:
+  RetireList() = default;
+  ~RetireList() {
+    for (auto object : mPending) {
+      delete object;
+    }
+    for (auto& entry : mRetired) {
+      delete entry.second;
+    }
+  }
+  RetireList(const RetireList&) = delete;
+  RetireList& operator=(const RetireList&) = delete;
+  void retire(const T* object) {
+    if (object) {
+      mPending.push_back(object);
+    }
+  }
+  // tag objects retired since the last call, free those no reader can see
+  void reclaim() {
+    if (!mPending.empty()) {
+      auto epoch = advanceReclamationEpoch();
+      for (auto object : mPending) {
+        mRetired.emplace_back(epoch, object);
+      }
+      mPending.clear();
+    }
+    if (mRetired.empty()) {
+      return;
+    }
+    auto oldestEpoch = getOldestActiveReclamationEpoch();
+    auto it = std::partition(mRetired.begin(), mRetired.end(), 
+            [oldestEpoch](const std::pair<uint64_t, const T*>& entry) { return entry.first >= oldestEpoch; });
+    for (auto freeIt = it; freeIt != mRetired.end(); ++freeIt) {
+      delete freeIt->second;
+    }
+    mRetired.erase(it, mRetired.end());
+  }
+private:
+  std::vector<const T*> mPending;
+  std::vector<std::pair<uint64_t, const T*>> mRetired;
+};
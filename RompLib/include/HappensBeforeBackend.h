@@ -0,0 +1,52 @@
+#pragma once
+#include <omp-tools.h>
+#include <string>
+
+#include "ParallelRegionData.h"
+#include "Record.h"
+#include "RecordManagement.h"
+#include "TaskData.h"
+
+/*
+ * HappensBeforeBackend is the interface between the ompt callbacks and the
+ * representation of logical time used to decide happens-before relation
+ * between two memory accesses. The callbacks handle the bookkeeping of task
+ * data and forward the synchronization events to the backend, which updates
+ * the timestamp of the affected tasks. The data race check asks the backend
+ * whether the history access happens before the current access.
+ *
+ * Two backends are available and selected per run with ROMP_HB_BACKEND:
+ *   label: offset-span task labels, supports all constructs (default)
+ *   vc:    FastTrack style epochs and vector clocks for parallel regions,
+ *          worksharing constructs and barriers without explicit tasks
+ *
+ * Whenever the timestamp or the lock set of a task changes, its mutateCount
+ * is bumped with markTaskMutated. The duplicate access filter is keyed by 
+ * mutateCount, so an access after the change is checked again.
+ */
+inline void markTaskMutated(TaskData* taskData) {
+  taskData->mutateCount++;
+}
+
+class HappensBeforeBackend {
+public:
+  virtual ~HappensBeforeBackend() {}
+  virtual const char* getName() const = 0;
+  virtual void onInitialTaskBegin(TaskData* taskData) = 0;
+  virtual void onParallelBegin(TaskData* encounteringTaskData, ParallelRegionData* parallelRegionData) = 0;
+  virtual void onParallelEnd(TaskData* encounteringTaskData, ParallelRegionData* parallelRegionData) = 0;
+  virtual void onImplicitTaskBegin(TaskData* parentTaskData, TaskData* taskData, unsigned int index, unsigned int actualParallelism) = 0;
+  // called once per parallel region, by the implicit task with index 0
+  virtual void onImplicitTaskEnd(TaskData* parentTaskData, TaskData* taskData) = 0;
+  virtual void onSyncRegion(TaskData* taskData, ParallelRegionData* parallelRegionData, ompt_sync_region_t kind, ompt_scope_endpoint_t endPoint) = 0;
+  virtual void onOrderedSection(TaskData* taskData, ompt_scope_endpoint_t endPoint) = 0;
+  virtual void onWork(TaskData* taskData, ompt_work_t workType, ompt_scope_endpoint_t endPoint, uint64_t count) = 0;
+  virtual void onDispatch(TaskData* taskData, ompt_dispatch_t kind, ompt_data_t instance) = 0;
+  virtual void onTaskCreate(TaskData* parentTaskData, TaskData* taskData) = 0;
+  virtual void onTaskComplete(TaskData* taskData) = 0;
+  void onLockSetChange(TaskData* taskData) { markTaskMutated(taskData); }
+  virtual bool happensBefore(const Record& histRecord, const Record& curRecord, ParallelRegionData* parallelRegionData, RecordManagementInfo& recordManagementInfo) = 0;
+  virtual std::string timestampToString(const Record& record) const = 0;
+};
+
+extern HappensBeforeBackend* gHappensBeforeBackend;
@@ -8,8 +8,14 @@
 
 #include "Callbacks.h"
 #include "CoreUtil.h"
+#include "DataRaceTable.h"
+#include "LockSetTable.h"
 #include "mcs-lock.h"
+#include "ShadowLockTable.h"
+#include "SiteSampler.h"
 #include "TaskInfoQuery.h"
+#include "TaskLabelBackend.h"
+#include "VectorClockBackend.h"
 
 /* 
  * This header file defines functions that are used 
@@ -19,15 +25,30 @@
 extern PerformanceCounters gPerformanceCounters;
 
 bool gDataRaceFound = false;
+bool gContinueAfterDataRace = false;
 bool gOmptInitialized = false; 
 bool gReportLineInfo = false;
 bool gReportAtRuntime = false;
 bool gUseWordLevelCheck = false;
+bool gSamplingEnabled = false;
 Dyninst::SymtabAPI::Symtab* gSymtabHandle = nullptr;
 
+TaskLabelBackend gTaskLabelBackend;
+VectorClockBackend gVectorClockBackend;
+HappensBeforeBackend* gHappensBeforeBackend = &gTaskLabelBackend;
+
+LockSetTable gLockSetTable;
+ShadowLockTable gShadowLockTable;
+SiteSampler gSiteSampler;
+
 mcs_lock_t gDataRaceLock;
 std::atomic_int gNumDataRace = 0;
-std::vector<DataRaceInfo> gDataRaceRecords;
+
+// read by the guard the instrumenter inlines in front of checkAccess calls
+extern "C" {
+std::atomic_uint32_t gNumActiveParallelRegions(0);
+}
+DataRaceTable gDataRaceRecords;
 
 ompt_get_task_info_t omptGetTaskInfo;
 ompt_get_parallel_info_t omptGetParallelInfo;
@@ -61,6 +82,44 @@ int omptInitialize(ompt_function_lookup_t lookup,
   if (word_level_flag != nullptr && std::string(word_level_flag) == "on") {
     gUseWordLevelCheck = true;
   }
+  auto hb_backend_flag = getenv("ROMP_HB_BACKEND");
+  if (hb_backend_flag != nullptr && std::string(hb_backend_flag) == "vc") {
+    gHappensBeforeBackend = &gVectorClockBackend;
+  }
+  LOG(INFO) << "happens-before backend: " << gHappensBeforeBackend->getName();
+  auto continue_flag = getenv("ROMP_CONTINUE_AFTER_RACE");
+  if (continue_flag != nullptr && std::string(continue_flag) == "on") {
+    gContinueAfterDataRace = true;
+  }
+  uint64_t maxNumDataRaces = 0;
+  auto max_data_races_flag = getenv("ROMP_MAX_DATA_RACES");
+  if (max_data_races_flag != nullptr) {
+    maxNumDataRaces = strtoull(max_data_races_flag, nullptr, 10);
+  }
+  gDataRaceRecords.init(maxNumDataRaces);
+  auto sampling_flag = getenv("ROMP_SAMPLING");
+  if (sampling_flag != nullptr && std::string(sampling_flag) == "on") {
+    gSamplingEnabled = true;
+    uint32_t samplingBurstLength = 0;
+    auto sampling_burst_flag = getenv("ROMP_SAMPLING_BURST");
+    if (sampling_burst_flag != nullptr) {
+      samplingBurstLength = strtoul(sampling_burst_flag, nullptr, 10);
+    }
+    double minSampleRate = 0;
+    auto sampling_min_rate_flag = getenv("ROMP_SAMPLING_MIN_RATE");
+    if (sampling_min_rate_flag != nullptr) {
+      minSampleRate = strtod(sampling_min_rate_flag, nullptr);
+    }
+    gSiteSampler.init(samplingBurstLength, minSampleRate);
+  }
+#ifdef STRIPED_SHADOW_LOCKS
+  uint64_t numShadowLockStripes = 0;
+  auto shadow_lock_stripes_flag = getenv("ROMP_SHADOW_LOCK_STRIPES");
+  if (shadow_lock_stripes_flag != nullptr) {
+    numShadowLockStripes = strtoull(shadow_lock_stripes_flag, nullptr, 10);
+  }
+  gShadowLockTable.init(numShadowLockStripes);
+#endif
 
   auto ompt_set_callback = 
       (ompt_set_callback_t)lookup("ompt_set_callback");
@@ -93,17 +152,27 @@ int omptInitialize(ompt_function_lookup_t lookup,
 void omptFinalize(ompt_data_t* toolData) {
   LOG(INFO) << "finalizing ompt";
   if (gDataRaceFound) {
-    LOG(INFO) << "data race found:";
-    if (gReportLineInfo) {
-      for (const auto& info : gDataRaceRecords) {
+    LOG(INFO) << "data race found: " << gNumDataRace.load();
+    auto numDroppedDataRaces = gDataRaceRecords.getNumDroppedDataRaces();
+    if (numDroppedDataRaces > 0) {
+      LOG(INFO) << "data races not recorded, set ROMP_MAX_DATA_RACES to record them: " << numDroppedDataRaces;
+    }
+    for (const auto& info : gDataRaceRecords.getDataRaces()) {
+      if (gReportLineInfo) {
         reportDataRaceWithLineInfo(info, gSymtabHandle);
-      } 
+      } else {
+        LOG(INFO) << "instn addr: " << info.instnAddrPrev << " vs instn addr: " << info.instnAddrCur 
+                  << " @ " << reinterpret_cast<void*>(info.memAddr);
+      }
     }
   } else {
     LOG(INFO) << "data race not found";
   }
 #ifdef PERFORMANCE
   gPerformanceCounters.printPerformanceCounters();
+#ifdef STRIPED_SHADOW_LOCKS
+  gShadowLockTable.printContention();
+#endif
 #endif
 }
 
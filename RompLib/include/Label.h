@@ -1,6 +1,8 @@
 #pragma once
+#include <atomic>
 #include <memory>
 #include <vector>
+#include "PoolAllocator.h"
 #include "Segment.h"
 
 enum LabelCompare {
@@ -9,6 +11,31 @@ enum LabelCompare {
   eSameLabel = -3,
   eLabelCompareUndefined = -4,
 };
+
+class Label;
+
+/*
+ * RegionSummary is shared by all labels created inside one parallel region.
+ * Once the region ends, it points to the label of the encountering task 
+ * right after the join. Every access inside the region happens before the 
+ * join, and any happens-before path from such an access to an access after 
+ * the region passes through the join. So a record created inside a finished 
+ * region can be compared using the shallow joined label instead of its own.
+ */
+class RegionSummary {
+public:
+  RegionSummary(const std::shared_ptr<RegionSummary>& enclosing): 
+      mIsJoined(false), mEnclosing(enclosing) {}
+  void setJoinedLabel(const std::shared_ptr<Label>& label);
+  bool isJoined() const { return mIsJoined.load(std::memory_order_acquire); }
+  const std::shared_ptr<Label>& getJoinedLabel() const { return mJoinedLabel; }
+  const std::shared_ptr<RegionSummary>& getEnclosing() const { return mEnclosing; }
+private:
+  std::shared_ptr<Label> mJoinedLabel; // written once before mIsJoined is set
+  std::atomic_bool mIsJoined;
+  std::shared_ptr<RegionSummary> mEnclosing;
+};
+
 /*
  * Label class implements the high level representation of task label.
  * A task label consists of a series of label segments. Each label segment is 
@@ -22,6 +49,8 @@ public:
   ~Label() {} 
   std::string toString() const;
   std::string toFieldsBreakdown() const;
+  void encode(std::vector<uint8_t>& buffer) const;
+  std::string toHexEncoding() const;
   void appendSegment(const std::shared_ptr<BaseSegment>& segment);
   std::shared_ptr<BaseSegment> popSegment();
   std::shared_ptr<BaseSegment> getLastKthSegment(int k);
@@ -29,11 +58,18 @@ public:
   BaseSegment * getKthSegment(int k);
   friend int compareLabels(Label* left, Label* right);
   int getLabelLength() const;
+  const std::shared_ptr<RegionSummary>& getRegionSummary() const;
+  void setRegionSummary(const std::shared_ptr<RegionSummary>& regionSummary);
 private:
-  std::vector<std::shared_ptr<BaseSegment> > mLabel;
+  std::vector<std::shared_ptr<BaseSegment>, PoolAllocator<std::shared_ptr<BaseSegment>> > mLabel;
+  std::shared_ptr<RegionSummary> mRegionSummary; // innermost parallel region the label is created in
 };
 
 int compareLabels(Label* left, Label* right);
+Label* getCompactLabel(Label* label);
+std::shared_ptr<Label> getCompactLabel(const std::shared_ptr<Label>& label);
+std::shared_ptr<Label> decodeLabel(const uint8_t* data, size_t size);
+std::shared_ptr<Label> decodeLabelFromHex(const std::string& hex);
 
 std::shared_ptr<Label> generateImplicitTaskLabel(
                           Label* parentLabel, 
@@ -1,23 +1,54 @@
 #pragma once
+#include <cstdint>
 #include <memory>
 #include <string>
-#include <unordered_map>
+#include <vector>
 
+#define LOCKSET_INLINE_CAPACITY 4
+
+/*
+ * LockSet stores the locks held by a task as a sorted array of lock ids.
+ * Tasks rarely hold more than a few locks, so up to LOCKSET_INLINE_CAPACITY
+ * locks are stored inline and only larger lock sets spill to the heap.
+ * A 64-bit signature has one bit set per lock id hash. Two lock sets whose
+ * signatures do not intersect have no common lock, which answers the
+ * common case of unrelated critical sections with a single AND.
+ *
+ * Lock sets held by tasks are interned by LockSetTable and never modified
+ * afterwards. Interned lock sets have a non-zero id.
+ */
 class LockSet {
 public:
   std::string toString() const;
   std::shared_ptr<LockSet> clone() const;
   void addLock(uint64_t lock);
   void removeLock(uint64_t lock);
-  LockSet() = default;
+  LockSet() : mId(0), mNumLocks(0), mSignature(0) {}
   ~LockSet() = default;
   LockSet(const LockSet& lockset);
   friend bool hasCommonLockImpl(const LockSet& l1, const LockSet& l2);
   friend bool isSubSetImpl(const LockSet& l1, const LockSet& l2);
   bool isEmpty() const;
+  bool operator==(const LockSet& other) const;
+  uint64_t hash() const;
+  uint32_t getId() const { return mId; }
+  uint64_t getSignature() const { return mSignature; }
 private:
-  std::unordered_map<uint64_t, uint64_t> mLock; 
+  friend class LockSetTable;
+  const uint64_t* begin() const;
+  const uint64_t* end() const;
+  void updateSignature();
+  uint32_t mId;
+  uint32_t mNumLocks;
+  uint64_t mSignature;
+  uint64_t mInlineLocks[LOCKSET_INLINE_CAPACITY];
+  std::vector<uint64_t> mOverflowLocks; // holds all locks if there are more than inline capacity
 };
 
 bool hasCommonLock(LockSet* l1, LockSet* l2);
 bool isSubSet(LockSet* l1, LockSet* l2);
+
+// return false if l1 and l2 certainly have no common lock
+inline bool mayHaveCommonLock(const LockSet* l1, const LockSet* l2) {
+  return (l1->getSignature() & l2->getSignature()) != 0;
+}
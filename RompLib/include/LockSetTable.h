@@ -0,0 +1,61 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "LockSet.h"
+#include "mcs-lock.h"
+#include "RecordManagement.h"
+
+#define LOCKSET_TABLE_MAX_ID ((1U << 24) - 1)
+#define LOCKSET_TABLE_INITIAL_CAPACITY 1024
+#define LOCK_RELATION_CACHE_SIZE 4096
+
+typedef struct LockSetSlots {
+  uint64_t capacity; // power of two
+  std::unique_ptr<std::atomic<LockSet*>[]> slots;
+} LockSetSlots;
+
+/*
+ * LockSetTable interns the lock sets held by tasks, so that a task entering
+ * a critical section it has entered before gets the same immutable lock set,
+ * identified by a small integer id. Relation between two lock sets is then
+ * a function of their ids, and is memoized in a direct mapped cache. Each 
+ * cache entry packs both ids and the relation in one word, so lookup and 
+ * update are single atomic loads and stores.
+ *
+ * Interned lock sets are found with a lock free probe of an open addressed
+ * table, so tasks entering and leaving critical sections share no cache 
+ * line on the common path. Only inserting a new lock set takes the insert
+ * lock. The table doubles when it is half full. A thread still probing the
+ * old table misses the lock sets inserted since, and finds them with the 
+ * insert lock held, so old tables are kept until the table is destroyed. 
+ * Interned lock sets live as long as the table, they are handed out as 
+ * shared pointers which own nothing, so copying them does not touch a 
+ * reference count.
+ *
+ * Once LOCKSET_TABLE_MAX_ID lock sets are interned, new lock sets are no 
+ * longer interned and their relations are computed every time.
+ */
+class LockSetTable {
+public:
+  LockSetTable();
+  std::shared_ptr<LockSet> addLock(const std::shared_ptr<LockSet>& lockSet, uint64_t lock);
+  std::shared_ptr<LockSet> removeLock(const std::shared_ptr<LockSet>& lockSet, uint64_t lock);
+  bool lookupRelation(const LockSet* histLockSet, const LockSet* curLockSet, LockRelation& lockRelation) const;
+  void storeRelation(const LockSet* histLockSet, const LockSet* curLockSet, LockRelation lockRelation);
+private:
+  std::shared_ptr<LockSet> intern(const LockSet& lockSet);
+  LockSet* find(const LockSet& lockSet, uint64_t hash) const;
+  void insert(LockSetSlots* table, LockSet* lockSet);
+  void grow();
+  mcs_lock_t mInsertLock;
+  std::atomic<LockSetSlots*> mTable;
+  std::vector<std::unique_ptr<LockSetSlots>> mTables; // current and outgrown tables
+  std::vector<std::unique_ptr<LockSet>> mLockSets; // interned lock sets, indexed by id - 1
+  uint32_t mNextId;
+  std::atomic<uint64_t> mRelationCache[LOCK_RELATION_CACHE_SIZE];
+};
+
+extern LockSetTable gLockSetTable;
@@ -1,21 +1,27 @@
 #pragma once
 #include <omp-tools.h>
 
+#include "Label.h"
 #include "pfq-rwlock.h"
 #include "TaskDependenceGraph.h"
+#include "VectorClock.h"
 
 typedef struct ParallelRegionData {
   void* dataPtr;  
   unsigned int numParallelism;
   int parallelFlag;
   pfq_rwlock_t lock;      
-  ParallelRegionData() { pfq_rwlock_init(&lock); }
+  uint32_t clockBase; // clock index of the implicit task with index 0
+  VectorClock barrierClocks[2]; // alternated by consecutive barriers
+  std::shared_ptr<RegionSummary> regionSummary; // shared by labels of implicit tasks
+  ParallelRegionData() : clockBase(0) { pfq_rwlock_init(&lock); }
   ParallelRegionData(unsigned int n, int p): numParallelism(n), parallelFlag(p) {
     dataPtr = nullptr; 
+    clockBase = 0;
     pfq_rwlock_init(&lock);
   } 
   TaskDependenceGraph taskDependenceGraph;
-  void maintainTaskDependence(void* taskPtr, const ompt_dependence_t& dependence);
+  void maintainTaskDependence(void* taskPtr, const ompt_dependence_t& dependence, std::vector<void*>& predecessors);
 } ParallelRegionData;
 
 
@@ -1,6 +1,11 @@
 #pragma once
 #include <atomic>
 
+#include "lock-wait.h"
+
+// bucket k counts lock waits of [2^k, 2^(k+1)) nanoseconds
+#define LOCK_WAIT_HISTOGRAM_BUCKETS 32
+
 class PerformanceCounters {
 public: 
   PerformanceCounters(int accessHisotryRecordThreshold): 
@@ -17,6 +22,17 @@ public:
   void updateMaximumAccessRecordsNum(uint64_t value_new); 
   void bumpNumTotalAccessRecordsTraversed(uint64_t numRecordsTraversed);
   void bumpNumSkipAddingCurrentRecord();
+  void bumpNumCompactRecordLabels();
+  void bumpNumTaskDependenceNodesCollected(uint64_t numNodes);
+  void bumpNumCheckDataRaceRetries();
+  void bumpNumAccessRecordAnalysesReused(uint64_t numAnalyses);
+  void bumpNumRuntimeContextRefreshes();
+  void bumpNumShadowMemoryAccessSkipped();
+  void bumpNumRepeatedAccessesFiltered();
+  void bumpNumAccessesSampled();
+  void bumpNumAccessesNotSampled();
+  void recordLockWaitTime(LockWaitType type, uint64_t nanoseconds);
+  void bumpNumLockParks();
   void printPerformanceCounters() const;
 private:
   std::atomic_uint64_t mNumMemoryAccessInstrumentationCall;
@@ -31,5 +47,16 @@ private:
   std::atomic_uint64_t mNumTotalAccessRecordsTraversed;
   std::atomic_uint64_t mNumAccessHistoryRemoveRecords;
   std::atomic_uint64_t mNumSkipAddingCurrentRecord; 
+  std::atomic_uint64_t mNumCompactRecordLabels;
+  std::atomic_uint64_t mNumTaskDependenceNodesCollected;
+  std::atomic_uint64_t mNumCheckDataRaceRetries;
+  std::atomic_uint64_t mNumAccessRecordAnalysesReused;
+  std::atomic_uint64_t mNumRuntimeContextRefreshes;
+  std::atomic_uint64_t mNumShadowMemoryAccessSkipped;
+  std::atomic_uint64_t mNumRepeatedAccessesFiltered;
+  std::atomic_uint64_t mNumAccessesSampled;
+  std::atomic_uint64_t mNumAccessesNotSampled;
+  std::atomic_uint64_t mLockWaitHistogram[eNumLockWaitTypes][LOCK_WAIT_HISTOGRAM_BUCKETS];
+  std::atomic_uint64_t mNumLockParks;
   int mAccessHistoryRecordThreshold;
 };
@@ -0,0 +1,62 @@
+#pragma once
+#include <cstddef>
+#include <memory>
+#include <utility>
+
+/*
+ * This header file declares PoolAllocator, a standard allocator that recycles
+ * memory blocks through thread local free lists, one list per size class.
+ * Labels and label segments are created on every label mutation and are 
+ * released by whichever thread drops the last record referring to them, 
+ * which is often not the thread that created them. 
+ *
+ * Every thread carves its blocks out of its own aligned chunks, and the 
+ * chunk header names the owning thread. A block released by its owner goes
+ * to the owner's free list. A block released by another thread is pushed
+ * onto a lock free return list of the owner, which the owner takes over as
+ * a whole once its free list runs empty. Blocks thus always come back to 
+ * the thread that allocates them, and in steady state label mutation does
+ * not go through the global heap. Chunks are never returned to the heap, so
+ * the pool keeps the peak memory of each size class. Blocks larger than the
+ * largest size class are served by malloc directly.
+ */
+#define POOL_MIN_BLOCK_SHIFT 4 // smallest size class is 16 bytes
+#define POOL_NUM_SIZE_CLASSES 8 // largest size class is 2048 bytes
+#define POOL_CHUNK_SIZE (64 * 1024) // per size class, aligned to its size
+
+void* poolAllocate(size_t size);
+void poolDeallocate(void* ptr, size_t size);
+
+template<typename T>
+class PoolAllocator {
+public:
+  typedef T value_type;
+  PoolAllocator() = default;
+  template<typename U>
+  PoolAllocator(const PoolAllocator<U>&) {}
+  T* allocate(size_t n) {
+    return static_cast<T*>(poolAllocate(n * sizeof(T)));
+  }
+  void deallocate(T* ptr, size_t n) {
+    poolDeallocate(static_cast<void*>(ptr), n * sizeof(T));
+  }
+};
+
+template<typename T, typename U>
+bool operator==(const PoolAllocator<T>&, const PoolAllocator<U>&) {
+  return true;
+}
+
+template<typename T, typename U>
+bool operator!=(const PoolAllocator<T>&, const PoolAllocator<U>&) {
+  return false;
+}
+
+/*
+ * Same as std::make_shared, except that the object and its control block 
+ * are allocated from the pool.
+ */
+template<typename T, typename... Args>
+std::shared_ptr<T> makePoolShared(Args&&... args) {
+  return std::allocate_shared<T>(PoolAllocator<T>(), std::forward<Args>(args)...);
+}
@@ -1,6 +1,7 @@
 #pragma once
 #include "Label.h"
 #include "LockSet.h"
+#include "VectorClock.h"
 
 /*
  * `Record` class stores a metadata associated with a single memory access.
@@ -8,9 +9,10 @@
 class Record {
 public:
   Record(): mState(0), mLabel(nullptr), mLockSet(nullptr), 
-    mTaskPtr(nullptr), mCheckedMemoryAddress(0){}
+    mTaskPtr(nullptr), mCheckedMemoryAddress(0), mEpoch(0){}
   Record(bool isWrite, 
          std::shared_ptr<Label> label, 
+         Epoch epoch,
          std::shared_ptr<LockSet> lockSet,   
          void* taskPtr, 
          uint64_t checkedMemoryAddress,
@@ -23,7 +25,7 @@ public:
       ): 
       mLabel(label), mLockSet(lockSet), mTaskPtr(taskPtr), 
       mCheckedMemoryAddress(checkedMemoryAddress),
-      mInstructionAddress(instructionAddress)
+      mInstructionAddress(instructionAddress), mEpoch(epoch)
       { 
         mState = 0;
         setAccessType(isWrite); 
@@ -38,12 +40,18 @@ public:
   void setHasHardwareLock(bool hardwareLock);
   void setIsInReduction(bool isInReduction);
   void setIsTLSAccess(bool isTLSAccess);
+  void setHoldsTaskReference(bool holdsTaskReference);
   bool isWrite() const;
   bool isInReduction() const;
   bool hasHardwareLock() const;
   bool isTLSAccess() const;
+  bool holdsTaskReference() const;
+  bool mayRaceWith(const Record& other) const;
+  bool hasSameAccessContext(const Record& other) const;
   std::string toString() const;
   Label* getLabel() const;
+  void compactLabel();
+  Epoch getEpoch() const;
   LockSet* getLockSet() const;
   uint64_t getCheckedMemoryAddress() const; 
   int getDataSharingType() const;
@@ -58,4 +66,5 @@ private:
   uint64_t  mCheckedMemoryAddress;  
   void* mInstructionAddress;  // store the instruction address associated with the memory access
   void* mOwner;   
+  Epoch mEpoch; // epoch of the encountering task, used by the vector clock backend
 };
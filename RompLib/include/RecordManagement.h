@@ -35,4 +35,5 @@ typedef struct RecordManagementInfo {
   NodeRelation nodeRelation; 
   LockRelation lockRelation; 
   OtherSynchronizationInfo otherSynchronizationInfo;
+  bool canCompactLabel; // history label can be replaced by the joined label of an ended region
 } RecordManagementInfo;
@@ -2,6 +2,7 @@
 #include <cstdint>
 #include <memory> 
 #include <string>
+#include <vector>
 
 enum SegmentType {
   eImplicit = 0x1,
@@ -20,6 +21,61 @@ enum TaskSyncType {
   eTaskwait,
   eTaskGroupEnd,
 };
+
+/*
+ * Describes where a counter of the label segment is stored: the index of the
+ * 64 bit word in the segment value, the shift inside that word and the number
+ * of bits of the field.
+ */
+struct SegmentField {
+  int word;
+  int shift;
+  int width;
+  constexpr uint64_t maxValue() const {
+    return width == 64 ? ~0UL : (1UL << width) - 1;
+  }
+  constexpr uint64_t mask() const {
+    return maxValue() << shift;
+  }
+};
+
+/*
+ * The compact layout packs all counters into a single 64 bit word. It is
+ * enough for small thread counts and short running parallel regions.
+ */
+struct CompactSegmentLayout {
+  static constexpr int kNumWords = 1;
+  static constexpr SegmentField kTaskCreate = {0, 7, 13};
+  static constexpr SegmentField kOffsetRebased = {0, 20, 1};
+  static constexpr SegmentField kLoopCount = {0, 24, 12};
+  static constexpr SegmentField kPhase = {0, 36, 4};
+  static constexpr SegmentField kTaskwait = {0, 40, 4};
+  static constexpr SegmentField kSpan = {0, 44, 10};
+  static constexpr SegmentField kOffset = {0, 54, 10};
+};
+
+/*
+ * The wide layout spreads the counters over three 64 bit words so that large
+ * thread counts, long running worksharing loops and many taskwaits do not 
+ * exhaust the counter fields. Selected by building with -DWIDE_SEGMENT.
+ */
+struct WideSegmentLayout {
+  static constexpr int kNumWords = 3;
+  static constexpr SegmentField kTaskCreate = {0, 7, 24};
+  static constexpr SegmentField kOffsetRebased = {0, 31, 1};
+  static constexpr SegmentField kTaskwait = {0, 32, 16};
+  static constexpr SegmentField kPhase = {0, 48, 16};
+  static constexpr SegmentField kLoopCount = {1, 0, 32};
+  static constexpr SegmentField kSpan = {1, 32, 32};
+  static constexpr SegmentField kOffset = {2, 0, 64};
+};
+
+#ifdef WIDE_SEGMENT
+typedef WideSegmentLayout SegmentLayout;
+#else
+typedef CompactSegmentLayout SegmentLayout;
+#endif
+
 /*
  *  The abstract class definition for label segment. 
  */
@@ -27,6 +83,7 @@ class Segment {
 public: 
   virtual std::string toString() const = 0;
   virtual std::string toFieldsBreakdown() const = 0;
+  virtual void encode(std::vector<uint8_t>& buffer) const = 0;
   virtual void setType(SegmentType type) = 0; 
   virtual SegmentType getType() const = 0;
   virtual bool operator==(const Segment& rhs) const = 0;
@@ -37,28 +94,31 @@ public:
 /*
  * Base segment is for representing implicit task with no 
  * worksharing construct attached to it.
- * mValue records most of the information wrt. openmp synchronization
+ * mValue records most of the information wrt. openmp synchronization, 
+ * its layout is described by SegmentLayout
  * mTaskGroup records the taskgroup information 
  * mOrderSecVal records ordered section phase when taskwait/taskgroup
  * sync happens
  */
 class BaseSegment : public Segment {
 public:
-  BaseSegment(): mValue(0), mTaskGroup(0), mOrderSecVal(0) {}
-  BaseSegment(const BaseSegment& segment): mValue(segment.mValue), 
-             mTaskGroup(segment.mTaskGroup), mOrderSecVal(segment.mOrderSecVal) {}
+  BaseSegment(): mValue(), mTaskGroup(0), mOrderSecVal(0) {}
+  BaseSegment(const BaseSegment& segment) = default;
   BaseSegment(SegmentType type, uint64_t offset, uint64_t span);
 
   std::string toString() const override;
   std::string toFieldsBreakdown() const override;
+  void encode(std::vector<uint8_t>& buffer) const override;
   void setType(SegmentType type) override;
   SegmentType getType() const override;
   bool operator==(const Segment& rhs) const override; 
   bool operator!=(const Segment& rhs) const override;
 
   std::shared_ptr<BaseSegment> clone() const;
+  static std::shared_ptr<BaseSegment> decode(const uint8_t*& cursor, const uint8_t* end);
 
   void setOffsetSpan(uint64_t offset, uint64_t span);
+  void advanceOffsetBySpan();
   void setTaskwait(uint64_t taskwait);
   void setTaskCreateCount(uint64_t taskcreate);
   void setPhase(uint64_t phase);
@@ -86,10 +146,13 @@ public:
   bool isTaskGroupSync() const;
   bool isSingleExecutor() const;
   bool isSingleOther() const; 
-  uint64_t getValue() const;
+  bool isOffsetRebased() const;
+  bool hasSameValue(const BaseSegment& segment) const;
 
 protected:
-  uint64_t mValue; // store most of the label segment fields.
+  uint64_t getField(const SegmentField& field) const;
+  void setField(const SegmentField& field, uint64_t value, const char* name);
+  uint64_t mValue[SegmentLayout::kNumWords]; // store most of the label segment fields.
   uint32_t mTaskGroup; // TODO: revisit taskgroup handling
   uint32_t mOrderSecVal;  
 };
@@ -109,6 +172,7 @@ public:
   }
   std::string toString() const override;
   std::string toFieldsBreakdown() const override;
+  void encode(std::vector<uint8_t>& buffer) const override;
   bool operator==(const Segment& rhs) const override;
   bool operator!=(const Segment& rhs) const override;
 
@@ -149,6 +213,7 @@ public:
 
   std::string toString() const override;
   std::string toFieldsBreakdown() const override;
+  void encode(std::vector<uint8_t>& buffer) const override;
   bool operator==(const Segment& rhs) const override;
   bool operator!=(const Segment& rhs) const override;
 private: 
@@ -156,3 +221,6 @@ private:
   uint64_t mWorkShareID; 
   uint8_t mWorkShareType; 
 };
+
+void encodeVarint(uint64_t value, std::vector<uint8_t>& buffer);
+bool decodeVarint(const uint8_t*& cursor, const uint8_t* end, uint64_t& value);
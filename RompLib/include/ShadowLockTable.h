@@ -0,0 +1,42 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <memory>
+
+#include "pfq-rwlock.h"
+
+#define SHADOW_LOCK_TABLE_DEFAULT_STRIPES 4096
+
+/*
+ * ShadowLockTable is a fixed table of reader-writer locks shared by the
+ * shadow memory cells. When romp is built with -DSTRIPED_SHADOW_LOCKS,
+ * AccessHistory carries no lock of its own and is protected by the stripe
+ * its address hashes to. A pfq_rwlock_t spans several cache lines, so this
+ * shrinks a shadow cell by more than an order of magnitude, at the cost of
+ * false contention between cells sharing a stripe.
+ *
+ * The number of stripes is rounded up to a power of two and could be set
+ * with ROMP_SHADOW_LOCK_STRIPES. Each stripe counts how often its lock was
+ * found contended, so that the false contention could be checked.
+ * A thread must not hold the lock of two shadow cells at the same time.
+ */
+typedef struct ShadowLockStripe {
+  pfq_rwlock_t lock;
+  std::atomic_uint64_t numContentions;
+} ShadowLockStripe;
+
+class ShadowLockTable {
+public:
+  ShadowLockTable() : mNumStripes(0), mStripeIndexShift(64) {}
+  void init(uint64_t numStripes);
+  pfq_rwlock_t& getLock(const void* cell);
+  std::atomic_uint64_t* getContentionCounter(const void* cell);
+  void printContention() const;
+private:
+  ShadowLockStripe& getStripe(const void* cell);
+  std::unique_ptr<ShadowLockStripe[]> mStripes;
+  uint64_t mNumStripes;
+  int mStripeIndexShift;
+};
+
+extern ShadowLockTable gShadowLockTable;
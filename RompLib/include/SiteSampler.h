@@ -0,0 +1,40 @@
+#pragma once
+#include <cstdint>
+
+#define SITE_SAMPLER_SLOTS 4096
+#define SITE_SAMPLER_DEFAULT_BURST_LENGTH 10
+#define SITE_SAMPLER_DEFAULT_MIN_RATE 0.001
+#define SITE_SAMPLER_MAX_PERIOD (1u << 31)
+
+typedef struct SiteSamplingState {
+  void* instnAddr;
+  uint64_t numSkipsLeft;   // executions to skip before the next sample
+  uint32_t numSamplesLeft; // samples left before the rate decays
+  uint32_t samplingPeriod; // one in samplingPeriod executions is sampled
+} SiteSamplingState;
+
+/*
+ * SiteSampler decides which executions of an instrumented access are 
+ * checked when romp runs with ROMP_SAMPLING=on. Following the cold region
+ * hypothesis of LiteRace, races are more likely at accesses that have 
+ * rarely executed, so every site starts fully sampled, and its sample rate
+ * halves after each burst of ROMP_SAMPLING_BURST samples down to 
+ * ROMP_SAMPLING_MIN_RATE, rounded down to a power of two. A site that is found racing is sampled fully 
+ * again. Sites are keyed by instruction address in a direct mapped table 
+ * per thread, so deciding takes no atomic operation. A site that evicts 
+ * another one starts fully sampled.
+ */
+class SiteSampler {
+public:
+  SiteSampler() : mBurstLength(SITE_SAMPLER_DEFAULT_BURST_LENGTH), mMaxSamplingPeriod(1) {}
+  void init(uint32_t burstLength, double minSampleRate);
+  bool shouldSample(void* instnAddr);
+  void onDataRace(void* instnAddr);
+private:
+  SiteSamplingState& getState(void* instnAddr);
+  uint32_t mBurstLength;
+  uint32_t mMaxSamplingPeriod;
+};
+
+extern bool gSamplingEnabled;
+extern SiteSampler gSiteSampler;
@@ -1,11 +1,15 @@
 #pragma once
+#include <atomic>
 #include <memory>
 #include <string>
 #include <unordered_map>
 #include <vector>
 
+#include "VectorClock.h"
+
 class Label;
 class LockSet;
+struct DependenceNode;
 
 typedef enum TaskFlag { 
   eIsExplicitTask = 0x0001,
@@ -19,6 +23,8 @@ typedef enum TaskFlag {
   eIsMergedTask = 0x0100, 
   eHasDependence = 0x0200,
   eIsComplete = 0x0400,
+  eIsReferenceCounted = 0x0800,
+  eIsInitialTask = 0x1000,
 } TaskFlag;
 
 /*
@@ -27,10 +33,21 @@ typedef enum TaskFlag {
  * data structure and could be retrieved through ompt query 
  * functions. Because each OpenMP task will get allocated 
  * one TaskData structure, compact data structure is preferred.
+ *
+ * Tasks created by task create callback are reference counted. A reference
+ * is held by the task itself until it completes, by every access record of
+ * the task, by every live explicit child task and by every undeferred task
+ * list it appears in. Once the count drops to zero, no happens-before query
+ * could refer to the task anymore and it is removed from the task dependence
+ * graph.
  */
 typedef struct TaskData {
   std::shared_ptr<Label> label;
   std::shared_ptr<LockSet> lockSet;
+  VectorClock vectorClock; // only maintained by the vector clock backend
+  Epoch epoch; // current epoch of the task in the vector clock backend
+  uint32_t clockIndex;
+  uint32_t numBarriers;
   void* exitFrame;
   void* parallelRegionDataPtr;
   std::vector<void*> childrenExplicitTasks;
@@ -39,11 +56,21 @@ typedef struct TaskData {
   uint16_t metaData;
   //uint8_t workShareRegionId;
   uint64_t mutateCount;
+  std::atomic<uint32_t> numReferences;
+  TaskData* parentTask; // explicit parent task which this task holds a reference of
+  std::atomic<const void*> dependenceGraph; // task dependence graph which published dependenceNode
+  std::atomic<const DependenceNode*> dependenceNode;
   TaskData();
   ~TaskData() { 
     duplicateMap.clear(); 
+    releaseUndeferredTasks();
   }
 
+  void acquireReference();
+  void releaseReference();
+  void releaseUndeferredTasks();
+  bool isReferenced() const;
+
   void recordExplicitTaskData(TaskData*);
   void recordUndeferredTaskData(TaskData*);
   void setIsExplicitTask(bool);
@@ -57,6 +84,8 @@ typedef struct TaskData {
   void setIsMergedTask(bool);
   void setHasDependence(bool);
   void setIsComplete(bool);
+  void setIsReferenceCounted(bool);
+  void setIsInitialTask(bool);
 
   bool getIsExplicitTask() const;
   bool getIsMutexTask() const;
@@ -68,4 +97,7 @@ typedef struct TaskData {
   bool getIsTaskwait() const;
   bool getIsMergedTask() const;
   bool getHasDependence() const;
+  bool getIsComplete() const;
+  bool getIsReferenceCounted() const;
+  bool getIsInitialTask() const;
 } TaskData;
@@ -1,23 +1,106 @@
 #pragma once
+#include <cstdint>
 #include <omp-tools.h>
 #include <unordered_map>
 #include <vector>
 
+#include "EpochReclamation.h"
+#include "mcs-lock.h"
+
+#define TASK_GRAPH_MIN_COLLECT_THRESHOLD 1024
+#define TASK_GRAPH_NUM_DEPENDENCE_SHARDS 64
+
 /*
  * Class TaskDependenceGraph maintains a directed acylic graph using map.
  * Each node is represented by the pointer to task's allocated TaskData data
  * structure. There exists a directed edge from node a to node b if task b 
  * is dependent on task a, i.e., task a happens before task b
+ *
+ * Dependences are registered in two steps. addDependence looks up the
+ * predecessors of the task in the state of the dependence variable, which
+ * is sharded by variable address and protected by the shard's lock. Only the
+ * last writers and the readers since then are kept per variable. The edges
+ * are then added by addEdges, with the writer lock of the parallel region
+ * held. Task producers only serialize on the region lock if the new task 
+ * has predecessors.
+ *
+ * Reachability is answered from an incrementally maintained chain 
+ * decomposition index. Nodes are partitioned into chains, each chain is a 
+ * path in the graph. Every node records, for each chain, the highest 
+ * position in that chain of a node that reaches it. Task b is reachable 
+ * from task a iff b's record for a's chain is not below a's position.
+ * The records are kept sparse, sorted by chain, and only for chains that 
+ * reach the node. In fan-out graphs every consumer starts a new chain, and
+ * a dense record per chain would make the index quadratic in the tasks.
+ *
+ * Tasks which are no longer referenced (see TaskData) are removed from the
+ * graph. Edges from every predecessor to every successor of a removed task
+ * are added so that reachability between the remaining tasks is preserved,
+ * which also keeps the index valid. Chains without any remaining task are
+ * reused, positions on a reused chain continue after its last position.
+ *
+ * The index is maintained by writers holding the writer lock of the parallel
+ * region. After every update, the changed index entries are published as
+ * immutable DependenceNode objects through the tasks' TaskData, so hasPath
+ * reads them without any lock. Replaced entries are freed with epoch based 
+ * reclamation.
  */	
+typedef struct ChainReach {
+  uint32_t chain;
+  uint32_t position; // highest position in the chain reaching the node
+} ChainReach;
+
+typedef struct DependenceNode {
+  uint32_t chain;
+  uint32_t position; // starts from 1 in every chain
+  std::vector<ChainReach> reach; // sorted by chain, chains not listed do not reach this node
+} DependenceNode;
+
 class TaskDependenceGraph {
     
 public:
-  TaskDependenceGraph() {}
-  ~TaskDependenceGraph(){}
-  void addDependence(void* taskPtr, const ompt_dependence_t& dependence);
-  bool hasPath(void* from, void* to);
+  TaskDependenceGraph();
+  ~TaskDependenceGraph();
+  void addDependence(void* taskPtr, const ompt_dependence_t& dependence, std::vector<void*>& predecessors);
+  void addEdges(void* taskPtr, const std::vector<void*>& predecessors);
+  bool hasPath(void* from, void* to) const;
+  void collectDeadTasks();
 private:
+  typedef struct ReachabilityNode : DependenceNode {
+    const DependenceNode* published; 
+    bool isDirty; // changed since published
+  } ReachabilityNode;
+  typedef struct DependenceEntry {
+    // the last 'out' or 'inout' task, or the tasks of the last group of 
+    // 'mutexinoutset' or 'inoutset' tasks which are not ordered among each other
+    std::vector<void*> writers;
+    std::vector<void*> readers; // 'in' tasks since the last writers
+    std::vector<void*> groupPredecessors; // predecessors of the last group
+    ompt_dependence_type_t writerType;
+  } DependenceEntry;
+  typedef struct DependenceShard {
+    mcs_lock_t lock;
+    std::unordered_map<void*, DependenceEntry> entries;
+  } DependenceShard;
+  typedef struct Chain {
+    uint32_t length; // position of the last node ever added to the chain
+    uint32_t numNodes; 
+  } Chain;
   void addEdge(void* from, void* to);
-  std::unordered_map<void*, std::vector<std::pair<void*, ompt_dependence_type_t>>> mDependences;
+  ReachabilityNode& getNode(void* taskPtr, ReachabilityNode* predecessor);
+  bool mergeReachability(ReachabilityNode& node, const ReachabilityNode& predecessor);
+  void propagateReachability(void* taskPtr);
+  void removeTask(void* taskPtr);
+  void markDirty(void* taskPtr, ReachabilityNode& node);
+  void publishNodes();
+  const DependenceNode* loadNode(void* taskPtr) const;
+  DependenceShard mShards[TASK_GRAPH_NUM_DEPENDENCE_SHARDS];
   std::unordered_map<void*, std::vector<void*>> mGraph;
+  std::unordered_map<void*, std::vector<void*>> mPredecessors;
+  std::unordered_map<void*, ReachabilityNode> mNodes;
+  std::vector<Chain> mChains;
+  std::vector<uint32_t> mFreeChains;
+  size_t mCollectThreshold; // number of nodes that triggers next collection
+  std::vector<void*> mDirtyTasks;
+  RetireList<DependenceNode> mRetiredNodes;
 };
@@ -1,5 +1,6 @@
 #pragma once
 #include <cstddef>
+#include <cstdint>
 #include <omp-tools.h>
 
 #include "ThreadData.h"
@@ -39,6 +40,55 @@ typedef struct TaskMemoryInfo {
   }
 } TaskMemoryInfo;
 
+/*
+ * The address ranges the data sharing analysis compares a memory address 
+ * with: the stack of the thread, the frame of the task on it and the task 
+ * private memory of an explicit task. They do not change while the task 
+ * runs, the runtime sets the enter frame only while the task is inside the 
+ * runtime. An address of 0 means the range is unknown.
+ */
+typedef struct TaskAddressBounds {
+  uint64_t stackBaseAddress;
+  uint64_t stackTopAddress;
+  uint64_t enterFrameAddress;
+  uint64_t exitFrameAddress;
+  uint64_t taskPrivateBaseAddress;
+  uint64_t taskPrivateEndAddress;
+} TaskAddressBounds;
+
+/*
+ * RuntimeContext caches the results of the ompt queries issued by 
+ * checkAccess for the task currently running on the thread. The returned 
+ * pointers refer to runtime owned data which stays in place while the task 
+ * runs, so fields read through them (e.g., the exit frame) are still current.
+ * The address bounds of the task are captured along. The callbacks 
+ * invalidate the context whenever the thread begins, ends or 
+ * switches tasks, and the next access refreshes it with the ompt queries.
+ */
+typedef struct RuntimeContext {
+  ThreadInfo threadInfo;
+  ParallelRegionInfo parallelRegionInfo;
+  TaskInfo taskInfo;
+  TaskMemoryInfo taskMemoryInfo;
+  TaskAddressBounds taskAddressBounds;
+} RuntimeContext;
+
+/*
+ * tDetectionActive is set while the thread runs a task other than the 
+ * initial task. It is maintained by the task callbacks so that checkAccess 
+ * returns after a single thread local load for accesses in sequential parts
+ * of the program and on threads not managed by the openmp runtime.
+ */
+extern thread_local bool tDetectionActive;
+
+/*
+ * tAccessEpoch advances whenever a callback may change what an access of the
+ * thread is checked against: the thread switches tasks, or the label, clock
+ * or lock set of its current task is mutated. Two accesses in the same epoch
+ * are checked against the same state of the task.
+ */
+extern thread_local uint64_t tAccessEpoch;
+
 bool queryIsSuccessful(const int queryResult);
 bool queryTaskInfo(const int ancestorLevel, TaskInfo& taskInfo);
 bool queryParallelRegionInfo(const int level, ParallelRegionInfo& parallelRegionInfo);
@@ -47,3 +97,6 @@ bool queryThreadStackInfo(void*& stackBaseAddress, size_t& stackSize);
 bool queryTaskMemoryInfo(void** addr, size_t* size);
 bool queryRuntimeInfo(ThreadInfo& threadInfo, ParallelRegionInfo& parallelRegionInfo, TaskInfo& taskInfo);
 bool queryTaskMemoryInfo(TaskMemoryInfo& taskMemoryInfo);
+const RuntimeContext* queryRuntimeContext();
+void invalidateRuntimeContext();
+void advanceAccessEpoch();
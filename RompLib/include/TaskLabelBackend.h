@@ -0,0 +1,24 @@
+#pragma once
+#include "HappensBeforeBackend.h"
+
+/*
+ * TaskLabelBackend maintains an offset-span task label for every task and
+ * decides happens-before relation by comparing task labels.
+ */
+class TaskLabelBackend : public HappensBeforeBackend {
+public:
+  const char* getName() const override { return "label"; }
+  void onInitialTaskBegin(TaskData* taskData) override;
+  void onParallelBegin(TaskData* encounteringTaskData, ParallelRegionData* parallelRegionData) override;
+  void onParallelEnd(TaskData* encounteringTaskData, ParallelRegionData* parallelRegionData) override;
+  void onImplicitTaskBegin(TaskData* parentTaskData, TaskData* taskData, unsigned int index, unsigned int actualParallelism) override;
+  void onImplicitTaskEnd(TaskData* parentTaskData, TaskData* taskData) override;
+  void onSyncRegion(TaskData* taskData, ParallelRegionData* parallelRegionData, ompt_sync_region_t kind, ompt_scope_endpoint_t endPoint) override;
+  void onOrderedSection(TaskData* taskData, ompt_scope_endpoint_t endPoint) override;
+  void onWork(TaskData* taskData, ompt_work_t workType, ompt_scope_endpoint_t endPoint, uint64_t count) override;
+  void onDispatch(TaskData* taskData, ompt_dispatch_t kind, ompt_data_t instance) override;
+  void onTaskCreate(TaskData* parentTaskData, TaskData* taskData) override;
+  void onTaskComplete(TaskData* taskData) override;
+  bool happensBefore(const Record& histRecord, const Record& curRecord, ParallelRegionData* parallelRegionData, RecordManagementInfo& recordManagementInfo) override;
+  std::string timestampToString(const Record& record) const override;
+};
@@ -0,0 +1,47 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/*
+ * An epoch c@i names the c-th logical time step of the clock component i.
+ * Following FastTrack, an access record only stores the epoch of the
+ * accessing task instead of its full vector clock. The component index is
+ * kept in the upper bits and the clock value in the lower bits.
+ */
+typedef uint64_t Epoch;
+
+#define EPOCH_CLOCK_BITS 40
+#define EPOCH_MAX_INDEX ((1UL << (64 - EPOCH_CLOCK_BITS)) - 1)
+
+inline Epoch makeEpoch(uint32_t index, uint64_t clock) {
+  return (static_cast<uint64_t>(index) << EPOCH_CLOCK_BITS) | clock;
+}
+
+inline uint32_t getEpochIndex(Epoch epoch) {
+  return static_cast<uint32_t>(epoch >> EPOCH_CLOCK_BITS);
+}
+
+inline uint64_t getEpochClock(Epoch epoch) {
+  return epoch & ((1UL << EPOCH_CLOCK_BITS) - 1);
+}
+
+std::string epochToString(Epoch epoch);
+
+/*
+ * VectorClock class implements a vector clock whose components are
+ * indexed by the clock index of implicit tasks. Components that are not
+ * stored explicitly are zero.
+ */
+class VectorClock {
+public:
+  VectorClock() {}
+  uint64_t get(uint32_t index) const;
+  void set(uint32_t index, uint64_t clock);
+  void increment(uint32_t index);
+  void join(const VectorClock& other);
+  bool covers(Epoch epoch) const;
+  std::string toString() const;
+private:
+  std::vector<uint64_t> mClock;
+};
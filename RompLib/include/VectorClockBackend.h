@@ -0,0 +1,47 @@
+#pragma once
+#include <atomic>
+
+#include "HappensBeforeBackend.h"
+
+/*
+ * VectorClockBackend implements the FastTrack style happens-before analysis
+ * for flat `parallel for` codes. Each implicit task owns one vector clock
+ * component, access records only store the epoch of the accessing task, and
+ * the check against the current task is a single comparison with the
+ * current task's vector clock.
+ *
+ * Fork joins the parent clock into the implicit tasks, barriers join the
+ * clocks of all implicit tasks in the team and the end of the parallel region
+ * joins the clock of the implicit task with index 0 back into the parent.
+ * Worksharing constructs without barrier do not synchronize and need no
+ * update. Explicit tasks and ordered sections are not supported, use the
+ * label backend for such codes.
+ *
+ * Implicit tasks of consecutive non-nested parallel regions reuse the same
+ * clock components because they are totally ordered by the join at the end
+ * of the previous region. Nested parallel regions allocate fresh components.
+ */
+class VectorClockBackend : public HappensBeforeBackend {
+public:
+  VectorClockBackend() : mNextClockIndex(1), mTopLevelClockBase(0), mTopLevelClockSpan(0) {}
+  const char* getName() const override { return "vc"; }
+  void onInitialTaskBegin(TaskData* taskData) override;
+  void onParallelBegin(TaskData* encounteringTaskData, ParallelRegionData* parallelRegionData) override;
+  void onParallelEnd(TaskData* encounteringTaskData, ParallelRegionData* parallelRegionData) override;
+  void onImplicitTaskBegin(TaskData* parentTaskData, TaskData* taskData, unsigned int index, unsigned int actualParallelism) override;
+  void onImplicitTaskEnd(TaskData* parentTaskData, TaskData* taskData) override;
+  void onSyncRegion(TaskData* taskData, ParallelRegionData* parallelRegionData, ompt_sync_region_t kind, ompt_scope_endpoint_t endPoint) override;
+  void onOrderedSection(TaskData* taskData, ompt_scope_endpoint_t endPoint) override;
+  void onWork(TaskData* taskData, ompt_work_t workType, ompt_scope_endpoint_t endPoint, uint64_t count) override;
+  void onDispatch(TaskData* taskData, ompt_dispatch_t kind, ompt_data_t instance) override;
+  void onTaskCreate(TaskData* parentTaskData, TaskData* taskData) override;
+  void onTaskComplete(TaskData* taskData) override;
+  bool happensBefore(const Record& histRecord, const Record& curRecord, ParallelRegionData* parallelRegionData, RecordManagementInfo& recordManagementInfo) override;
+  std::string timestampToString(const Record& record) const override;
+private:
+  uint32_t allocateClockIndices(unsigned int num);
+  std::atomic<uint32_t> mNextClockIndex;
+  // only accessed by the initial thread which encounters non-nested regions
+  uint32_t mTopLevelClockBase;
+  uint32_t mTopLevelClockSpan;
+};
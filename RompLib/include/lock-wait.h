@@ -0,0 +1,63 @@
+#ifndef _lock_wait_h_
+#define _lock_wait_h_
+
+#include <atomic>
+#include <stdint.h>
+
+/*
+ * Waiting on the flags of mcs_lock and pfq_rwlock.
+ *
+ * By default waiters spin until the flag is cleared. When romp is built with
+ * -DLOCK_SPIN_THEN_PARK, a waiter spins for LOCK_SPIN_LIMIT iterations and
+ * then parks on a futex until the flag is cleared. This avoids burning the
+ * waiter's quantum while the lock holder is descheduled, which happens when
+ * there are more threads than cores. The thread clearing the flag only
+ * issues the wake up system call if some waiter has parked.
+ */
+
+#ifndef LOCK_SPIN_LIMIT
+#define LOCK_SPIN_LIMIT 1024
+#endif
+
+#define LOCK_FLAG_CLEAR  0
+#define LOCK_FLAG_SET    1
+#define LOCK_FLAG_PARKED 2 // set, and some waiter may be parked
+
+typedef std::atomic<uint32_t> lock_flag_t;
+
+typedef enum LockWaitType {
+  eMutexWait,   // waiting for the mcs lock
+  eReadWait,    // reader waiting for the writer
+  eWriteWait,   // writer waiting for the readers to drain
+  eNumLockWaitTypes,
+} LockWaitType;
+
+static inline void
+lock_cpu_relax()
+{
+#if defined(__x86_64__) || defined(__i386__)
+  __builtin_ia32_pause();
+#endif
+}
+
+//----------------------------------------------------------------------
+// wait until the flag is cleared. the load that observes the cleared
+// flag has acquire ordering
+//----------------------------------------------------------------------
+void
+lock_flag_wait(lock_flag_t *flag, LockWaitType type);
+
+//----------------------------------------------------------------------
+// clear the flag with release ordering and wake up parked waiters,
+// either one or all of them
+//----------------------------------------------------------------------
+void
+lock_flag_clear(lock_flag_t *flag, bool wake_all);
+
+//----------------------------------------------------------------------
+// back off in a loop waiting for a condition that is not a lock flag
+//----------------------------------------------------------------------
+void
+lock_spin_relax(uint32_t *spins);
+
+#endif
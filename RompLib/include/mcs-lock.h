@@ -69,6 +69,8 @@
 #include <atomic>
 #include <stdbool.h>
 
+#include "lock-wait.h"
+
 
 //******************************************************************************
 // types
@@ -76,7 +78,7 @@
 
 typedef struct mcs_node_s {
   std::atomic<struct mcs_node_s*> next;
-  std::atomic_bool blocked;
+  lock_flag_t blocked;
 } mcs_node_t;
 
 
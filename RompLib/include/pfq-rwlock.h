@@ -99,7 +99,7 @@
 typedef mcs_node_t pfq_rwlock_node_t;
 
 typedef struct bigbool {
-  std::atomic_bool bit cache_aligned;
+  lock_flag_t bit cache_aligned;
 } bigbool;
 
 class PerformanceCounters;
@@ -127,7 +127,7 @@ typedef struct {
 
 void pfq_rwlock_init(pfq_rwlock_t *l);
 
-void pfq_rwlock_read_lock(pfq_rwlock_t *l, PerformanceCounters* performanceCounters);
+bool pfq_rwlock_read_lock(pfq_rwlock_t *l, PerformanceCounters* performanceCounters);
 
 void pfq_rwlock_read_unlock(pfq_rwlock_t *l);
 
@@ -17,12 +17,16 @@ LockGuard::~LockGuard() {
   mcs_unlock(mLock, mNode);
 }
 
-ReaderWriterLockGuard::ReaderWriterLockGuard(pfq_rwlock_t* lock, pfq_rwlock_node_t* node, PerformanceCounters* performanceCounters) {
+ReaderWriterLockGuard::ReaderWriterLockGuard(pfq_rwlock_t* lock, pfq_rwlock_node_t* node, PerformanceCounters* performanceCounters, std::atomic_uint64_t* contentionCounter) {
   mLock = lock;
   mNode = node;
   mPerformanceCounters = performanceCounters; 
+  mContentionCounter = contentionCounter;
   mWriteLockAcquired = false; 
-  pfq_rwlock_read_lock(mLock, mPerformanceCounters);
+  auto hasContention = pfq_rwlock_read_lock(mLock, mPerformanceCounters);
+  if (hasContention && mContentionCounter) {
+    mContentionCounter->fetch_add(1, std::memory_order_relaxed);
+  }
 }
 
 ReaderWriterLockGuard::~ReaderWriterLockGuard() {
@@ -39,5 +43,9 @@ bool ReaderWriterLockGuard::upgradeFromReaderToWriter() {
     return false;
   }
   mWriteLockAcquired = true;
-  return pfq_rwlock_upgrade_from_read_to_write_lock(mLock, mNode, mPerformanceCounters); 
+  auto hasWriteWriteContention = pfq_rwlock_upgrade_from_read_to_write_lock(mLock, mNode, mPerformanceCounters); 
+  if (hasWriteWriteContention && mContentionCounter) {
+    mContentionCounter->fetch_add(1, std::memory_order_relaxed);
+  }
+  return hasWriteWriteContention;
 }
@@ -3,14 +3,39 @@
 #include <glog/logging.h>
 #include <glog/raw_logging.h>
 
+#include "ShadowLockTable.h"
+#include "TaskData.h"
+
+/*
+ * Records of reference counted tasks keep the task alive in the task 
+ * dependence graph while they stay in access history.
+ */
+inline void acquireTaskReference(Record& record) {
+  auto taskData = static_cast<TaskData*>(record.getTaskPtr());
+  if (taskData && taskData->getIsReferenceCounted()) {
+    taskData->acquireReference();
+    record.setHoldsTaskReference(true);
+  }
+}
+
+inline void releaseTaskReference(const Record& record) {
+  if (record.holdsTaskReference()) {
+    static_cast<TaskData*>(record.getTaskPtr())->releaseReference();
+  }
+}
+
 AccessHistory::AccessHistory() {
   mState = 0;
+  mVersion = 0;
+#ifndef STRIPED_SHADOW_LOCKS
   pfq_rwlock_init(&mLock);
+#endif
   mRecords = std::make_unique<std::vector<Record>>();
 }
 
 void AccessHistory::setOwner(void* owner) {
   mOwner = owner;
+  mVersion++;
 }
 
 void* AccessHistory::getOwner() const {
@@ -18,7 +43,23 @@ void* AccessHistory::getOwner() const {
 }
 
 pfq_rwlock_t & AccessHistory::getLock() {
+#ifdef STRIPED_SHADOW_LOCKS
+  return gShadowLockTable.getLock(this);
+#else
   return mLock;
+#endif
+}
+
+/*
+ * Return the contention counter of the stripe protecting this access history,
+ * or nullptr if the access history has its own lock.
+ */
+std::atomic_uint64_t* AccessHistory::getLockContentionCounter() {
+#ifdef STRIPED_SHADOW_LOCKS
+  return gShadowLockTable.getContentionCounter(this);
+#else
+  return nullptr;
+#endif
 }
 
 std::vector<Record>* AccessHistory::getRecords() {
@@ -39,8 +80,12 @@ void AccessHistory::clearFlags() {
 
 void AccessHistory::clearRecords() {
   if (mRecords) {
+    for (const auto& record : *mRecords) {
+      releaseTaskReference(record);
+    }
     mRecords->clear();
   }
+  mVersion++;
 }
 
 void AccessHistory::addRecordToAccessHistory(const Record& record) {
@@ -48,6 +93,8 @@ void AccessHistory::addRecordToAccessHistory(const Record& record) {
     mRecords = std::make_unique<std::vector<Record>>();   
   }
   mRecords->push_back(record);
+  acquireTaskReference(mRecords->back());
+  mVersion++;
 }
 
 bool AccessHistory::dataRaceFound() const {
@@ -70,17 +117,37 @@ uint64_t AccessHistory::getNumRecords() const {
   return mRecords ? mRecords->size() : 0;
 }
 
+/*
+ * Records analyzed under the reader lock are still valid after upgrading 
+ * to the writer lock iff the version is unchanged. Compacting labels does
+ * not change the version since compacted labels are equivalent.
+ */
+uint32_t AccessHistory::getVersion() const {
+  return mVersion;
+}
+
+void AccessHistory::compactRecordLabels() {
+  if (!mRecords) {
+    return;
+  }
+  for (auto& record : *mRecords) {
+    record.compactLabel();
+  }
+}
+
 void AccessHistory::removeRecords(const std::vector<int>& recordsToBeRemoved) {
   if (!mRecords ||  mRecords->empty()) {
     return; 
   }
   if (recordsToBeRemoved.size() > mRecords->size()) {
-    RAW_DLOG(WARNING, "records to be removed: %d record size: %d", recordsToBeRemoved.size(), mRecords->size());
+    RAW_DLOG(WARNING, "records to be removed: %zu record size: %zu", recordsToBeRemoved.size(), mRecords->size());
     //TODO: fix record removal candidate number larger than record size problem.
     //For now we abort this removal 
     return; 
   }
   for (auto it = recordsToBeRemoved.rbegin(); it != recordsToBeRemoved.rend(); it++) {
+    releaseTaskReference(mRecords->at(*it));
     mRecords->erase(mRecords->begin() + *it);
   }  
+  mVersion++;
 }
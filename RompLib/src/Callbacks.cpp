@@ -7,7 +7,8 @@
 #include "AccessHistory.h"
 #include "CoreUtil.h"
 #include "DataSharing.h"
-#include "Label.h"
+#include "HappensBeforeBackend.h"
+#include "LockSetTable.h"
 #include "ParallelRegionData.h"
 #include "PerformanceCounters.h"
 #include "TaskInfoQuery.h"
@@ -17,6 +18,7 @@
 
 extern ShadowMemory<AccessHistory> shadowMemory;
 extern PerformanceCounters gPerformanceCounters;
+extern "C" std::atomic_uint32_t gNumActiveParallelRegions;
    
 void on_ompt_callback_implicit_task(
        ompt_scope_endpoint_t endPoint,
@@ -25,10 +27,13 @@ void on_ompt_callback_implicit_task(
        unsigned int actualParallelism,
        unsigned int index,
        int flags) {
+  // the thread begins or ends a task, refresh the runtime context on next access
+  invalidateRuntimeContext();
   if (flags == ompt_task_initial) {
     auto initTaskData = new TaskData();
-    auto newTaskLabel = generateInitialTaskLabel();
-    initTaskData->label = std::move(newTaskLabel);
+    initTaskData->setIsInitialTask(true);
+    tDetectionActive = false;
+    gHappensBeforeBackend->onInitialTaskBegin(initTaskData);
     initTaskData->parallelRegionDataPtr = parallelData->ptr;
     taskData->ptr = static_cast<void*>(initTaskData);
     return;
@@ -45,6 +50,7 @@ void on_ompt_callback_implicit_task(
     }
     delete taskDataPtr; 
     taskData->ptr = nullptr;
+    tDetectionActive = false;
     return;
   }
   TaskInfo parentTaskInfo;
@@ -56,187 +62,75 @@ void on_ompt_callback_implicit_task(
   switch(endPoint) {
     case ompt_scope_begin:
     {
-      // begin of implcit task, create the label for this new task
-      auto newTaskLabel = generateImplicitTaskLabel((parentTaskData->label).get(), index, actualParallelism); 
-      // return value optimization should avoid the ref count mod
+      // begin of implcit task, create the timestamp for this new task
       auto newTaskDataPtr = new TaskData();
-      // cast to rvalue and avoid atomic ref count modification
-      newTaskDataPtr->label = std::move(newTaskLabel); 
-      newTaskDataPtr->mutateCount++;
       newTaskDataPtr->parallelRegionDataPtr = parallelData->ptr;
+      gHappensBeforeBackend->onImplicitTaskBegin(parentTaskData, newTaskDataPtr, index, actualParallelism);
       taskData->ptr = static_cast<void*>(newTaskDataPtr);
+      tDetectionActive = true;
       return;
     }
     case ompt_scope_end:
     {
-      // End of the current implicit task, modify parent task's label
+      // End of the current implicit task, modify parent task's timestamp
       // only one worker thread with index 0 is responsible for mutating
-      // the parent task label. The mutated label should be created separately
-      // because access history referred to labels by pointer.
+      // the parent task timestamp. 
       // At this point, only one implicit task should reach here.
       if (!taskDataPtr) { 
         RAW_LOG(FATAL, "task data pointer is null");
       }
-      auto mutatedLabel = mutateParentImpEnd(taskDataPtr->label.get());
-      parentTaskData->label = std::move(mutatedLabel);
-      parentTaskData->mutateCount++;
+      gHappensBeforeBackend->onImplicitTaskEnd(parentTaskData, taskDataPtr);
       delete taskDataPtr; 
       taskData->ptr = nullptr;
+      // the thread continues with the encountering task
+      tDetectionActive = parentTaskData && !parentTaskData->getIsInitialTask();
       return;
     }
   }
 }
 
-inline BaseSegment* getLastSegment(Label* label) {
-  auto lenLabel = label->getLabelLength();
-  return label->getKthSegment(lenLabel - 1);
-}
-
-/*
- * Once a task encounters a taskwait, mark the task's explicit children to 
- * be taskwaited, and record the ordered section phase value 
- */
-void markExpChildSyncTaskwait(TaskData* taskData, Label* curLabel) {
-  auto segment = getLastSegment(curLabel);
-  auto phase = segment->getPhase();
-  for (auto& child : taskData->childrenExplicitTasks) {
-    auto childTaskData = static_cast<TaskData*>(child); 
-    childTaskData->setIsTaskwait(true); 
-    auto lastSegment = getLastSegment(childTaskData->label.get());
-    uint64_t offset, span;
-    lastSegment->getOffsetSpan(offset, span);
-    if (span == 1) { // if the last label segment is still explicit label segment, set the taskwaited flag in segment
-      lastSegment->setTaskwaited();
-      lastSegment->setTaskwaitPhase(phase); 
-    }
-  }
-  taskData->childrenExplicitTasks.clear(); // clear the children after taskwait
-}
-
-/*
- * Once a task encounters the end of taskgroup, mark all explicit task 
- * children which are inside the ending taskgroup. 
- */
-void markExpChildSyncTaskGroupEnd(TaskData* taskData, Label* curLabel) {
-  auto seg = getLastSegment(curLabel);
-  auto phase = seg->getPhase();
-  auto taskGroupLevel = seg->getTaskGroupLevel();
-  auto taskGroupId = seg->getTaskGroupId(); 
-  auto it = taskData->childrenExplicitTasks.begin();
-  auto lenParentLabel = curLabel->getLabelLength();
-  while (it != taskData->childrenExplicitTasks.end()) {
-    auto childTaskData = static_cast<TaskData*>(*it);
-    auto childLabel = childTaskData->label;
-    auto lenChildLabel = childLabel->getLabelLength();
-    if (lenChildLabel > lenParentLabel) {
-      // This child task is not inside current task group
-      it++; 
-    } else {
-      auto lastSeg = childLabel->getLastKthSegment(1);    
-      // check if the task group id matches  
-      auto childTaskGroupId = lastSeg->getTaskGroupId();
-      if (childTaskGroupId == taskGroupId) {
-        auto mutatedChildLabel = mutateTaskGroupSyncChild(childLabel.get());
-        childTaskData->label = std::move(mutatedChildLabel);
-        it = taskData->childrenExplicitTasks.erase(it);
-      } else {
-        it++;
-      }
-    }
-  }
-}
-
 void on_ompt_callback_sync_region(
        ompt_sync_region_t kind,
        ompt_scope_endpoint_t endPoint,
        ompt_data_t *parallelData,
        ompt_data_t *taskData,
        const void* codePtrReturnAddress) {
+  advanceAccessEpoch();
   if (!taskData || !taskData->ptr) {
     RAW_LOG(FATAL, "task data pointer is null");  
     return;
   }
   auto taskDataPtr = static_cast<TaskData*>(taskData->ptr);
-  auto labelPtr = (taskDataPtr->label).get();  // never std::move here!
-  std::shared_ptr<Label> mutatedLabel = nullptr;
-  switch(kind) {
-    case ompt_sync_region_barrier:
-    case ompt_sync_region_barrier_implicit:
-    case ompt_sync_region_barrier_explicit:
-    case ompt_sync_region_barrier_implementation:
-    {
-      if (endPoint == ompt_scope_end) {
-        mutatedLabel = mutateBarrierEnd(labelPtr);
-      }   
-      break;
-    }
-    case ompt_sync_region_taskwait:
-    {
-      if (endPoint == ompt_scope_begin) {
-        mutatedLabel = mutateTaskWait(labelPtr);
-        markExpChildSyncTaskwait(taskDataPtr, labelPtr);
-      }
-      break;
-    }
-    case ompt_sync_region_taskgroup:
-    {
-      if (endPoint == ompt_scope_begin) {
-        mutatedLabel = mutateTaskGroupBegin(labelPtr);
-      } else if (endPoint == ompt_scope_end) {
-        mutatedLabel = mutateTaskGroupEnd(labelPtr);
-        markExpChildSyncTaskGroupEnd(taskDataPtr, labelPtr);
-      }
-      break;
-    }
-    case ompt_sync_region_reduction:
-    {
-      // Note: callback for reduction is replaced by ompt_callback_reduction
-      if (endPoint == ompt_scope_begin) { 
-        taskDataPtr->setIsInReduction(true);
-      } else if (endPoint == ompt_scope_end) {
-        taskDataPtr->setIsInReduction(false);
-      } 
-    }
-    default:
-      RAW_LOG(FATAL, "unknown ompt_sync_region_t type: %d", kind);
-      break;
-  }
-  if (mutatedLabel != nullptr) { // for default case, don't modify
-    taskDataPtr->label = std::move(mutatedLabel);
-    taskDataPtr->mutateCount++;
+  if (kind == ompt_sync_region_reduction) {
+    // Note: callback for reduction is replaced by ompt_callback_reduction
+    if (endPoint == ompt_scope_begin) { 
+      taskDataPtr->setIsInReduction(true);
+    } else if (endPoint == ompt_scope_end) {
+      taskDataPtr->setIsInReduction(false);
+    } 
+    return;
   }
-  return;
+  auto parallelRegionData = parallelData ? static_cast<ParallelRegionData*>(parallelData->ptr) : nullptr;
+  gHappensBeforeBackend->onSyncRegion(taskDataPtr, parallelRegionData, kind, endPoint);
 }
 
 void on_ompt_callback_mutex_acquired(
         ompt_mutex_t kind,
         ompt_wait_id_t waitId,
         const void *codePtrRa) {
+  advanceAccessEpoch();
   TaskInfo taskInfo;
   if (!queryTaskInfo(0, taskInfo)) {
     RAW_LOG(FATAL, "task data pointer is null");
     return;
   }
   auto taskDataPtr = static_cast<TaskData*>(taskInfo.taskData->ptr);
-  auto label = taskDataPtr->label;
-  std::shared_ptr<Label> mutatedLabel = nullptr;
   if (kind == ompt_mutex_ordered) {
-    mutatedLabel = mutateOrderSection(label.get()); 
+    gHappensBeforeBackend->onOrderedSection(taskDataPtr, ompt_scope_begin);
   } else {
-    if (taskDataPtr->lockSet == nullptr) {
-      auto lockSet = std::make_shared<LockSet>();
-      taskDataPtr->lockSet = std::move(lockSet);
-      taskDataPtr->lockSet->addLock(static_cast<uint64_t>(waitId));
-    } else {
-      // we need to clone the old lockset before modifying it
-      auto clonedLockSet = taskDataPtr->lockSet->clone();
-      clonedLockSet->addLock(static_cast<uint64_t>(waitId));
-      taskDataPtr->lockSet = std::move(clonedLockSet);
-    }
-  }
-  if (mutatedLabel) {
-    taskDataPtr->label = std::move(mutatedLabel);
-    taskDataPtr->mutateCount++;
+    // lock sets are immutable once interned, records may refer to the old one
+    taskDataPtr->lockSet = gLockSetTable.addLock(taskDataPtr->lockSet, static_cast<uint64_t>(waitId));
+    gHappensBeforeBackend->onLockSetChange(taskDataPtr);
   }
 }
 
@@ -244,6 +138,7 @@ void on_ompt_callback_mutex_released(
         ompt_mutex_t kind,
         ompt_wait_id_t waitId,
         const void *codePtrRa) {
+  advanceAccessEpoch();
   void* dataPtr;
   TaskInfo taskInfo;
   if (!queryTaskInfo(0, taskInfo)) {
@@ -251,81 +146,14 @@ void on_ompt_callback_mutex_released(
     return;
   } 
   auto taskDataPtr = static_cast<TaskData*>(taskInfo.taskData->ptr);
-  auto label = taskDataPtr->label;
-  std::shared_ptr<Label> mutatedLabel = nullptr; 
   if (kind == ompt_mutex_ordered) {
-    mutatedLabel = mutateOrderSection(label.get());
+    gHappensBeforeBackend->onOrderedSection(taskDataPtr, ompt_scope_end);
   } else {
-    // we need to clone the old lockset before modifying it
-    auto clonedLockSet = taskDataPtr->lockSet->clone();
-    clonedLockSet->removeLock(waitId);
-    taskDataPtr->lockSet = std::move(clonedLockSet);
-  }
-  if (mutatedLabel) {
-    taskDataPtr->label = std::move(mutatedLabel);
-    taskDataPtr->mutateCount++;
+    taskDataPtr->lockSet = gLockSetTable.removeLock(taskDataPtr->lockSet, static_cast<uint64_t>(waitId));
+    gHappensBeforeBackend->onLockSetChange(taskDataPtr);
   }
 }
 
-inline std::shared_ptr<Label> mutateTaskLabelOnWorkLoopCallback(
-                             ompt_scope_endpoint_t endPoint, 
-                             const std::shared_ptr<Label>& label) {
-  std::shared_ptr<Label> mutatedLabel = nullptr;
-  auto labelPtr = label.get();
-  if (endPoint == ompt_scope_begin) {
-    mutatedLabel = mutateLoopBegin(labelPtr);
-  } else if (endPoint == ompt_scope_end) {
-    mutatedLabel = mutateLoopEnd(labelPtr);
-  }  
-  return mutatedLabel;
-}
-
-inline std::shared_ptr<Label> mutateTaskLabelOnWorkSectionsCallback(
-        ompt_scope_endpoint_t endPoint, 
-        const std::shared_ptr<Label>& label,
-        uint64_t count) {
-  std::shared_ptr<Label> mutatedLabel = nullptr;
-  auto labelPtr = label.get();
-  if (endPoint == ompt_scope_begin) {
-    mutatedLabel = mutateSectionBegin(labelPtr);
-  } else if (endPoint == ompt_scope_end) {
-    mutatedLabel = mutateSectionEnd(labelPtr);
-  }
-  return mutatedLabel;
-}
-
-inline std::shared_ptr<Label> mutateTaskLabelOnTaskLoopCallback(
-    ompt_scope_endpoint_t endPoint,
-    const std::shared_ptr<Label>& label, 
-    uint64_t count) {
-  std::shared_ptr<Label> mutatedLabel = nullptr;
-  auto labelPtr = label.get();
-  RAW_DLOG(INFO, "mutate on task loop, count: %d", count);
-  if (endPoint == ompt_scope_begin) {
-    mutatedLabel = mutateLoopBegin(labelPtr);
-  } else if (endPoint == ompt_scope_end) {
-    mutatedLabel = mutateLoopEnd(labelPtr);
-  }  
-  return mutatedLabel;  
-}
-   
-
-inline std::shared_ptr<Label> mutateTaskLabelOnWorkSingleExecutorCallback(
-        ompt_scope_endpoint_t endPoint, 
-        const std::shared_ptr<Label>& label) {
-  auto labelPtr = label.get();
-  std::shared_ptr<Label> mutatedLabel = mutateSingleExecutor(labelPtr);
-  return mutatedLabel;
-}
-
-inline std::shared_ptr<Label> mutateTaskLabelOnWorkSingleOtherCallback(
-        ompt_scope_endpoint_t endPoint, 
-        const std::shared_ptr<Label>& label) {
-  auto labelPtr = label.get();
-  std::shared_ptr<Label> mutatedLabel =  mutateSingleOther(labelPtr);
-  return mutatedLabel;
-}
-
 void on_ompt_callback_work(
       ompt_work_t workType,
       ompt_scope_endpoint_t endPoint,
@@ -333,39 +161,12 @@ void on_ompt_callback_work(
       ompt_data_t *taskData,
       uint64_t count,
       const void *codePtrRa) {
+  advanceAccessEpoch();
   if (!taskData || !taskData->ptr) {
     RAW_LOG(FATAL, "task data pointer is null");
   }
   auto taskDataPtr = static_cast<TaskData*>(taskData->ptr);
-  auto label = taskDataPtr->label;
-  std::shared_ptr<Label> mutatedLabel = nullptr;
-  switch(workType) {
-    case ompt_work_loop: 
-      mutatedLabel = mutateTaskLabelOnWorkLoopCallback(endPoint, label);
-      break;
-    case ompt_work_sections:
-      mutatedLabel = mutateTaskLabelOnWorkSectionsCallback(endPoint, label, count);
-      break;
-    case ompt_work_single_executor:
-      mutatedLabel = mutateTaskLabelOnWorkSingleExecutorCallback(endPoint, label);
-      break;
-    case ompt_work_single_other:
-      mutatedLabel = mutateTaskLabelOnWorkSingleOtherCallback(endPoint, label);
-      break;
-    case ompt_work_workshare:
-      RAW_LOG(FATAL, "ompt_work_workshare is not supported yet");
-      break;
-    case ompt_work_distribute:
-      RAW_LOG(FATAL, "ompt_work_distribute is not supported yet");
-      break;
-    case ompt_work_taskloop:
-      mutatedLabel = mutateTaskLabelOnTaskLoopCallback(endPoint, label, count); 
-      break;
-    default:
-      break;
-  }
-  taskDataPtr->label = std::move(mutatedLabel);
-  taskDataPtr->mutateCount++;
+  gHappensBeforeBackend->onWork(taskDataPtr, workType, endPoint, count);
 }
 
 void on_ompt_callback_parallel_begin(
@@ -375,7 +176,11 @@ void on_ompt_callback_parallel_begin(
        unsigned int requestedParallelism,
        int flags,
        const void *codePtrRa) {
+  invalidateRuntimeContext();
+  gNumActiveParallelRegions.fetch_add(1, std::memory_order_relaxed);
   auto parallelRegionData = new ParallelRegionData(requestedParallelism, flags);
+  auto encounteringTaskDataPtr = encounteringTaskData ? static_cast<TaskData*>(encounteringTaskData->ptr) : nullptr;
+  gHappensBeforeBackend->onParallelBegin(encounteringTaskDataPtr, parallelRegionData);
   parallelData->ptr = static_cast<void*>(parallelRegionData);  
 }
 
@@ -384,8 +189,12 @@ void on_ompt_callback_parallel_end(
        ompt_data_t *encounteringTaskData,
        int flags,
        const void *codePtrRa) {
-  auto parRegionData = parallelData->ptr;
-  delete static_cast<ParallelRegionData*>(parRegionData);
+  invalidateRuntimeContext();
+  auto parRegionData = static_cast<ParallelRegionData*>(parallelData->ptr);
+  auto encounteringTaskDataPtr = encounteringTaskData ? static_cast<TaskData*>(encounteringTaskData->ptr) : nullptr;
+  gHappensBeforeBackend->onParallelEnd(encounteringTaskDataPtr, parRegionData);
+  delete parRegionData;
+  gNumActiveParallelRegions.fetch_sub(1, std::memory_order_relaxed);
 }  
 
 void on_ompt_callback_task_create(
@@ -395,6 +204,7 @@ void on_ompt_callback_task_create(
         int flags,
         int hasDependences,
         const void *codePtrRa) {
+  advanceAccessEpoch();
   // In current llvm-openmp implementation:
   // https://github.com/llvm/llvm-project/blob/83914ee96fc2d828e1cfb8913f5d156d39150e2c/openmp/runtime/src/kmp_tasking.cpp#L795
   // flags is a variable where multiple bits can be set
@@ -407,8 +217,8 @@ void on_ompt_callback_task_create(
   auto isMergeable = (flags & ompt_task_mergeable) == ompt_task_mergeable;
   auto isTaskwait = (flags & ompt_task_taskwait) == ompt_task_taskwait;
   auto parentTaskData = static_cast<TaskData*>(encounteringTaskData->ptr); 
-  if (!parentTaskData || !parentTaskData->label) {
-    RAW_LOG(FATAL, "cannot get parent task label");
+  if (!parentTaskData) {
+    RAW_LOG(FATAL, "cannot get parent task data");
     return;
   }  
   auto taskData = new TaskData();
@@ -421,13 +231,16 @@ void on_ompt_callback_task_create(
   taskData->setIsMergeableTask(isMergeable);
   taskData->setIsTaskwait(isTaskwait);
   taskData->setHasDependence(hasDependences > 0);
+  // the task holds a reference of itself until it completes
+  taskData->setIsReferenceCounted(true);
+  taskData->acquireReference();
+  if (parentTaskData->getIsReferenceCounted()) {
+    parentTaskData->acquireReference();
+    taskData->parentTask = parentTaskData;
+  }
   // there is one case where the flags == ompt_task_taskwait | ompt_task_undeferred | ompt_task_mergeable
   // one example is #pragma omp task deps(in:x) if(0) we still treat this as explicit task.
-  auto parentLabel = (parentTaskData->label).get();
-  taskData->label = generateExplicitTaskLabel(parentLabel, static_cast<void*>(taskData));
-  auto mutatedParentLabel = mutateParentTaskCreate(parentLabel); 
-  parentTaskData->label = std::move(mutatedParentLabel);
-  parentTaskData->mutateCount++; 
+  gHappensBeforeBackend->onTaskCreate(parentTaskData, taskData);
   if (isExplicitTask) {
     parentTaskData->recordExplicitTaskData(taskData); 
   }
@@ -445,16 +258,21 @@ void handleTaskComplete(void* taskPtr) {
     return;
   }
   auto taskDataPtr = static_cast<TaskData*>(taskPtr);
-  auto label = (taskDataPtr->label).get();
-  auto mutatedLabel = mutateTaskComplete(label);
-  taskDataPtr->label = std::move(mutatedLabel);
-  taskDataPtr->mutateCount++;
+  gHappensBeforeBackend->onTaskComplete(taskDataPtr);
+  if (taskDataPtr->getIsReferenceCounted() && !taskDataPtr->getIsComplete()) {
+    taskDataPtr->setIsComplete(true);
+    taskDataPtr->releaseUndeferredTasks();
+    taskDataPtr->releaseReference();
+  }
 }
 
 void on_ompt_callback_task_schedule(
         ompt_data_t *priorTaskData,
         ompt_task_status_t priorTaskStatus,
         ompt_data_t *nextTaskData) {
+  invalidateRuntimeContext();
+  auto nextTaskPtr = nextTaskData ? static_cast<TaskData*>(nextTaskData->ptr) : nullptr;
+  tDetectionActive = nextTaskPtr && !nextTaskPtr->getIsInitialTask();
   auto priorTaskPtr = priorTaskData->ptr;
   switch(priorTaskStatus) {
     case ompt_task_complete:
@@ -475,6 +293,7 @@ void on_ompt_callback_task_schedule(
 }
 
 void on_ompt_callback_dependences(ompt_data_t *taskData, const ompt_dependence_t *deps, int ndeps) {
+  advanceAccessEpoch();
   RAW_DLOG(INFO, "ompt_callback_dependences");
   auto taskPtr = taskData->ptr;
   if (!taskPtr) {
@@ -492,6 +311,15 @@ void on_ompt_callback_dependences(ompt_data_t *taskData, const ompt_dependence_t
     RAW_LOG(FATAL, "callback dependences: current parallel data ptr is null");
     return;
   }
+  // look up the predecessors under the locks of the dependence variables
+  std::vector<void*> predecessors;
+  for (int i = 0; i < ndeps; ++i) {
+    RAW_DLOG(INFO, "maintain task dependence: %lx", taskPtr);
+    parallelRegionData->maintainTaskDependence(taskPtr, deps[i], predecessors);
+  }
+  if (predecessors.empty()) {
+    return;
+  }
   pfq_rwlock_node_t node;      
 #ifdef PERFORMANCE
   ReaderWriterLockGuard guard(&(parallelRegionData->lock), &node, &gPerformanceCounters);
@@ -499,16 +327,16 @@ void on_ompt_callback_dependences(ompt_data_t *taskData, const ompt_dependence_t
   ReaderWriterLockGuard guard(&(parallelRegionData->lock), &node, nullptr);
 #endif
   guard.upgradeFromReaderToWriter();   
-  // while in mutual exculsion, maintain explicit task dependences
-  for (int i = 0; i < ndeps; ++i) {
-    RAW_DLOG(INFO, "maintain task dependence: %lx", taskPtr);
-    parallelRegionData->maintainTaskDependence(taskPtr, deps[i]);
-  }
+  // while in mutual exculsion, add the explicit task dependence edges
+  parallelRegionData->taskDependenceGraph.collectDeadTasks();
+  parallelRegionData->taskDependenceGraph.addEdges(taskPtr, predecessors);
 }
 
 void on_ompt_callback_thread_begin(
        ompt_thread_t threadType,
        ompt_data_t *threadData) {
+  invalidateRuntimeContext();
+  tDetectionActive = false;
   if (!threadData) {
     RAW_LOG(FATAL, "thread data is null");
     return;
@@ -538,6 +366,8 @@ void on_ompt_callback_thread_begin(
 
 void on_ompt_callback_thread_end(
        ompt_data_t *threadData) {
+  invalidateRuntimeContext();
+  tDetectionActive = false;
   if (!threadData) {
     return;
   }
@@ -552,39 +382,13 @@ void on_ompt_callback_dispatch(
        ompt_data_t *taskData,
        ompt_dispatch_t kind,
        ompt_data_t instance) {
+  advanceAccessEpoch();
   if (!taskData || !taskData->ptr) {
     RAW_LOG(FATAL, "cannot get task data info");
     return;
   }
   auto taskDataPtr = static_cast<TaskData*>(taskData->ptr);
-  auto parentLabel = (taskDataPtr->label).get();
-  std::shared_ptr<Label> mutatedLabel = nullptr;
-  //ompt_dispatch_chunk_t *dispatchChunk = nullptr;
-  switch(kind) {
-//    case ompt_dispatch_ws_loop_chunk:
-//      dispatchChunk = (ompt_dispatch_chunk_t *)instance.ptr;    
-//      mutatedLabel = mutateWorkShareIterationDispatch(parentLabel, dispatchChunk->start);
-//      break;
-//    case ompt_dispatch_taskloop_chunk:
-//      dispatchChunk = (ompt_dispatch_chunk_t *)instance.ptr;    
-//      RAW_LOG(FATAL, "not implemented yet. task loop dispatch"); 
-//      break;
-//    case ompt_dispatch_distribute_chunk:
-//      dispatchChunk = (ompt_dispatch_chunk_t *)instance.ptr;    
-//      RAW_LOG(FATAL, "not implemented yet, distributed dispatch");
-//      break;
-    case ompt_dispatch_iteration:
-      mutatedLabel = mutateWorkShareIterationDispatch(parentLabel, instance.value);
-      break;
-   case ompt_dispatch_section:
-      mutatedLabel = mutateSectionDispatch(parentLabel, instance.ptr);
-      break; 
-   default:
-     RAW_LOG(FATAL, "unexpected case %d", kind);
- }
- taskDataPtr->label = std::move(mutatedLabel);
- taskDataPtr->mutateCount++;
-
+  gHappensBeforeBackend->onDispatch(taskDataPtr, kind, instance);
 }
 
 void on_ompt_callback_reduction(
@@ -593,6 +397,7 @@ void on_ompt_callback_reduction(
        ompt_data_t *parallelData,
        ompt_data_t *taskData,
        const void *codePtrReturnAddress) {
+  advanceAccessEpoch();
   if (!taskData || !taskData->ptr) {
     RAW_LOG(FATAL, "task data pointer is null");
     return;
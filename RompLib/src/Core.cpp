@@ -3,6 +3,10 @@
 #include <glog/logging.h>
 #include <glog/raw_logging.h>
 
+#include "CoreUtil.h"
+#include "DataRaceTable.h"
+#include "HappensBeforeBackend.h"
+#include "LockSetTable.h"
 #include "ParallelRegionData.h"
 #include "RecordManagement.h"
 #include "TaskData.h"
@@ -10,19 +14,36 @@
 #include "ThreadData.h"
 
 extern PerformanceCounters gPerformanceCounters;
+extern DataRaceTable gDataRaceRecords;
+extern std::atomic_int gNumDataRace;
+extern bool gReportAtRuntime;
+
+// access histories with at least this many records are analyzed in two passes
+#define LONG_ACCESS_HISTORY_THRESHOLD 32
+
+/*
+ * Return true if debug log messages at info level are emitted. RAW_DLOG
+ * evaluates its arguments in debug builds even when the message is filtered 
+ * out, so guard any argument that needs formatting with this function.
+ */
+inline bool isDebugInfoLogOn() {
+#ifdef NDEBUG
+  return false;
+#else
+  return FLAGS_minloglevel <= google::GLOG_INFO;
+#endif
+}
 
-bool analyzeRaceCondition(const Record& histRecord, const Record& curRecord, RecordManagementInfo& recordManagementInfo) {
+bool analyzeRaceCondition(const Record& histRecord, const Record& curRecord, ParallelRegionData* parallelRegionData, RecordManagementInfo& recordManagementInfo) {
   auto checkedAddress = curRecord.getCheckedMemoryAddress();
-  auto histLabel = histRecord.getLabel(); 
-  auto curLabel = curRecord.getLabel(); 
   // we want to set both lock set info and node relation info so we don't early return.
   recordManagementInfo.nodeRelation = eUndefinedNodeRelation;
   recordManagementInfo.lockRelation = eUndefinedLockRelation;
-  int diffIndex;
+  recordManagementInfo.canCompactLabel = false;
   auto hasCommonLock = analyzeMutualExclusion(histRecord, curRecord, recordManagementInfo);
   auto histTaskData = static_cast<TaskData*>(histRecord.getTaskPtr()); 
   auto curTaskData = static_cast<TaskData*>(curRecord.getTaskPtr());
-  auto isHistoryAccessBeforeCurrentAccess = happensBefore(histLabel, curLabel, diffIndex, histTaskData, curTaskData, recordManagementInfo);    
+  auto isHistoryAccessBeforeCurrentAccess = gHappensBeforeBackend->happensBefore(histRecord, curRecord, parallelRegionData, recordManagementInfo);    
 
 //  if (histTaskData == curTaskData) {
 //    // both memory accesses are performed by the same task. 
@@ -67,8 +88,8 @@ bool analyzeRaceCondition(const Record& histRecord, const Record& curRecord, Rec
   auto historyDataSharingType = histRecord.getDataSharingType();
   auto bothAccessesAreTaskPrivate = ((currentDataSharingType == eThreadPrivateAccessCurrentTask || currentDataSharingType == eExplicitTaskPrivate) && (historyDataSharingType == eThreadPrivateAccessCurrentTask || historyDataSharingType == eExplicitTaskPrivate));
   auto hasDataRace = !isHistoryAccessBeforeCurrentAccess && (histRecord.isWrite() || curRecord.isWrite()) && !bothAccessesAreTaskPrivate;
-  if (hasDataRace) {
-    RAW_DLOG(INFO, "data race found! hist is write: %d cur is write: %d , memr addr: %lx cur instn: %lx hist instn: %lx hist label: %s cur label: %s hist fields breakd down: %s cur fields break down: %s hist owner: %lx cur owner: %lx", histRecord.isWrite(), curRecord.isWrite(), checkedAddress, curRecord.getInstructionAddress(), histRecord.getInstructionAddress(), histRecord.getLabel()->toString().c_str(), curRecord.getLabel()->toString().c_str(), histRecord.getLabel()->toFieldsBreakdown().c_str(), curRecord.getLabel()->toFieldsBreakdown().c_str(), histRecord.getMemoryAddressOwner(), curRecord.getMemoryAddressOwner());
+  if (hasDataRace && isDebugInfoLogOn()) {
+    RAW_DLOG(INFO, "data race found! hist is write: %d cur is write: %d , memr addr: %lx cur instn: %lx hist instn: %lx hist timestamp: %s cur timestamp: %s hist owner: %lx cur owner: %lx", histRecord.isWrite(), curRecord.isWrite(), checkedAddress, curRecord.getInstructionAddress(), histRecord.getInstructionAddress(), gHappensBeforeBackend->timestampToString(histRecord).c_str(), gHappensBeforeBackend->timestampToString(curRecord).c_str(), histRecord.getMemoryAddressOwner(), curRecord.getMemoryAddressOwner());
   }
   return hasDataRace;
 }
@@ -96,27 +117,40 @@ bool analyzeMutualExclusion(const Record& histRecord, const Record& curRecord, R
     recordManagementInfo.lockRelation = eHistoryNoLockCurrentHasLock;
     return false;
   }
+  LockRelation lockRelation;
+  if (!gLockSetTable.lookupRelation(histLockSet, curLockSet, lockRelation)) {
+    lockRelation = computeLockRelation(histLockSet, curLockSet);
+    gLockSetTable.storeRelation(histLockSet, curLockSet, lockRelation);
+  }
+  recordManagementInfo.lockRelation = lockRelation;
+  return lockRelation == eCurrentLockSetContainsHistoryLockSetNonEmpty || 
+         lockRelation == eHistoryLockSetContainsCurrentLockSetNonEmpty || 
+         lockRelation == eHasCommonLock;
+}
+
+// both lock sets have at least one lock
+LockRelation computeLockRelation(LockSet* histLockSet, LockSet* curLockSet) {
+  if (!mayHaveCommonLock(histLockSet, curLockSet)) {
+    // signatures are disjoint, neither lock set could contain the other
+    return eNoCommonLock;
+  }
   if (isSubSet(histLockSet, curLockSet)) {
-    recordManagementInfo.lockRelation = eCurrentLockSetContainsHistoryLockSetNonEmpty;
-    return true;
+    return eCurrentLockSetContainsHistoryLockSetNonEmpty;
   } 
   if (isSubSet(curLockSet, histLockSet)) {
-    recordManagementInfo.lockRelation = eHistoryLockSetContainsCurrentLockSetNonEmpty;
-    return true;
+    return eHistoryLockSetContainsCurrentLockSetNonEmpty;
   }
   if (hasCommonLock(curLockSet, histLockSet)) {
-    recordManagementInfo.lockRelation = eHasCommonLock;
-    return true;
+    return eHasCommonLock;
   }
-  recordManagementInfo.lockRelation = eNoCommonLock;
-  return false;
+  return eNoCommonLock;
 }
 
 // assuming proper concurrency control for access history
 void  setMemoryOwner(AccessHistory* accessHistory, int dataSharingType, void* taskData, void* memoryAddress) {
   if (dataSharingType == eThreadPrivateAccessCurrentTask || dataSharingType == eExplicitTaskPrivate) {
     pfq_rwlock_node_t me;
-    ReaderWriterLockGuard guard(&(accessHistory->getLock()), &me, &gPerformanceCounters);
+    ReaderWriterLockGuard guard(&(accessHistory->getLock()), &me, &gPerformanceCounters, accessHistory->getLockContentionCounter());
     if (accessHistory->getOwner() != taskData) {
       guard.upgradeFromReaderToWriter();
       accessHistory->setOwner(taskData);
@@ -124,7 +158,7 @@ void  setMemoryOwner(AccessHistory* accessHistory, int dataSharingType, void* ta
   } 
 }
 
-bool happensBefore(Label* histLabel, Label* curLabel, int& diffIndex, TaskData* histTaskData, TaskData* curTaskData, RecordManagementInfo& recordManagementInfo) {
+bool happensBefore(Label* histLabel, Label* curLabel, int& diffIndex, TaskData* histTaskData, TaskData* curTaskData, ParallelRegionData* parallelRegionData, RecordManagementInfo& recordManagementInfo) {
   diffIndex = compareLabels(histLabel, curLabel);
   auto histHappensBeforeCur = false;
   if (diffIndex < 0) {
@@ -165,7 +199,7 @@ bool happensBefore(Label* histLabel, Label* curLabel, int& diffIndex, TaskData*
         break;
       case eExplicit:
         // same explciit task for T(histLabel[diffIndex]) and T(curLabel[diffIndex])
-        histHappensBeforeCur = analyzeSameTask(histLabel, curLabel, diffIndex, recordManagementInfo);
+        histHappensBeforeCur = analyzeSameTask(histLabel, curLabel, diffIndex, parallelRegionData, recordManagementInfo);
         break;
       default:
         RAW_LOG(FATAL, "unexpected segment type: %d", histType);
@@ -175,7 +209,7 @@ bool happensBefore(Label* histLabel, Label* curLabel, int& diffIndex, TaskData*
   if (histOffset != curOffset) { 
     auto span = histSpan;
     if (histOffset % span == curOffset % span) {
-      RAW_CHECK(histOffset < curOffset, "not expecting history access joined \
+      RAW_CHECK(histOffset < curOffset || curSegment->isOffsetRebased(), "not expecting history access joined \
                before current access");
       recordManagementInfo.nodeRelation = eHappensBefore;
       histHappensBeforeCur = true;
@@ -183,23 +217,16 @@ bool happensBefore(Label* histLabel, Label* curLabel, int& diffIndex, TaskData*
       histHappensBeforeCur = analyzeSiblingImplicitTask(histLabel, curLabel, diffIndex, recordManagementInfo);
     } 
   } else {
-    histHappensBeforeCur = analyzeSameTask(histLabel, curLabel, diffIndex, recordManagementInfo); 
+    histHappensBeforeCur = analyzeSameTask(histLabel, curLabel, diffIndex, parallelRegionData, recordManagementInfo); 
   } 
   // comparing task label does not infer happens-before relation. Addtionally we check other situations
   // that are not recorded in task label to make final decision of happens-before relation.
   if (histHappensBeforeCur == false) {
     // further check explicit task dependence if current task and history task 
     // are both explicit tasks. If there exists task dependence, no data race.
-    if (histTaskData->getIsExplicitTask()) {
-      ParallelRegionInfo parallelRegionInfo;
-      RAW_CHECK(queryParallelRegionInfo(0, parallelRegionInfo) == true, "cannot get parallel region data");
-      auto parallelRegionData = static_cast<ParallelRegionData*>(parallelRegionInfo.parallelData->ptr); 
-      pfq_rwlock_node_t node;
-#ifdef PERFORMANCE
-        ReaderWriterLockGuard guard(&(parallelRegionData->lock), &node, &gPerformanceCounters); // needed in happens before analys
-#else
-        ReaderWriterLockGuard guard(&(parallelRegionData->lock), &node, nullptr);
-#endif
+    // The dependence graph publishes its reachability index to readers, so no
+    // region lock is taken here.
+    if (parallelRegionData && histTaskData->getIsExplicitTask()) {
       if (curTaskData->getIsExplicitTask()) {
         // both history task and current task are explicit task. Check if there exists explicit task dependence between them. 
         if (parallelRegionData->taskDependenceGraph.hasPath(static_cast<void*>(histTaskData), static_cast<void*>(curTaskData))) {
@@ -370,7 +397,7 @@ bool analyzeExplicitTaskSynchronizationWithTaskWait(Label* label, int startIndex
 // This function is called under the premise that offset field is the same.
 // There exists fields in histLabel[diffIndex] and curLabel[diffIndex] that are different.
 // Return true if there exists happens-before relationship. Return false otherwise.
-bool analyzeSameTask(Label* histLabel, Label* curLabel, int diffIndex, RecordManagementInfo& recordManagementInfo) {
+bool analyzeSameTask(Label* histLabel, Label* curLabel, int diffIndex, ParallelRegionData* parallelRegionData, RecordManagementInfo& recordManagementInfo) {
   auto lenHistLabel = histLabel->getLabelLength(); 
   auto lenCurLabel = curLabel->getLabelLength();
   auto histDiffSegmentIsLeaf = diffIndex == (lenHistLabel - 1);
@@ -457,7 +484,7 @@ bool analyzeSameTask(Label* histLabel, Label* curLabel, int diffIndex, RecordMan
     auto curNextType = curNextSegment->getType();
     if (histNextType == eExplicit && curNextType == eExplicit) {
       // curLabel[diffIndex + 1] and histLabel[diffIndex + 1] are explicit task label segments.
-      return analyzeExplicitTask(histLabel, curLabel, diffIndex, recordManagementInfo); 
+      return analyzeExplicitTask(histLabel, curLabel, diffIndex, parallelRegionData, recordManagementInfo); 
     } 
     RAW_CHECK(!(histNextType == eImplicit && curNextType == eImplicit), "not expecting next level tasks are sibling implicit tasks");
     RAW_CHECK(!(histNextType == eLogical && curNextType == eLogical), "not expecting next level tasks are sibling logical tasks");
@@ -473,7 +500,7 @@ bool analyzeSameTask(Label* histLabel, Label* curLabel, int diffIndex, RecordMan
 
 
 //  histLabel[diffIndex + 1] and curLabel[diffIndex + 1] are explicit task segment
-bool analyzeExplicitTask(Label* histLabel, Label* curLabel, int diffIndex, RecordManagementInfo& recordManagementInfo) {
+bool analyzeExplicitTask(Label* histLabel, Label* curLabel, int diffIndex, ParallelRegionData* parallelRegionData, RecordManagementInfo& recordManagementInfo) {
   // First check if ordered by task group construct   
   if (analyzeTaskGroupSync(histLabel, curLabel, diffIndex)) {
     recordManagementInfo.nodeRelation = eHappensBefore;
@@ -486,16 +513,8 @@ bool analyzeExplicitTask(Label* histLabel, Label* curLabel, int diffIndex, Recor
   auto curNextSegment = static_cast<ExplicitTaskSegment*>(curLabel->getKthSegment(diffIndex + 1));
   auto histNextTaskPtr = histNextSegment->getTaskPtr();
   auto curNextTaskPtr = curNextSegment->getTaskPtr();   
-  ParallelRegionInfo parallelRegionInfo;
-  RAW_CHECK(queryParallelRegionInfo(0, parallelRegionInfo) == true, "cannot get parallel region data");
-  auto parallelRegionData = static_cast<ParallelRegionData*>(parallelRegionInfo.parallelData->ptr); 
-  pfq_rwlock_node_t node;
-#ifdef PERFORMANCE
-  ReaderWriterLockGuard guard(&(parallelRegionData->lock), &node, &gPerformanceCounters); // needed in happens before analys
-#else
-  ReaderWriterLockGuard guard(&(parallelRegionData->lock), &node, nullptr);
-#endif
-  if (parallelRegionData->taskDependenceGraph.hasPath(histNextTaskPtr, curNextTaskPtr)) {
+  // without parallel region data (offline analysis) no dependence is known
+  if (parallelRegionData && parallelRegionData->taskDependenceGraph.hasPath(histNextTaskPtr, curNextTaskPtr)) {
     return analyzeExplicitTaskSynchronizationWithTaskWait(histLabel, diffIndex + 2, recordManagementInfo) && analyzeExplicitTaskSynchronizationWithTaskWait(curLabel, diffIndex + 2, recordManagementInfo);
   } else {
     // There is no explicit task dependence between T1 and T2, we further check the synchronization enforced by taskwait
@@ -538,12 +557,29 @@ uint64_t computeEnterRank(uint64_t phase) {
   return phase + (phase % 2);
 }
 
+// Replace the labels of records created inside ended parallel regions by the
+// joined labels, so that later comparisons and label memory are proportional 
+// to the live nesting depth. Called with write lock held.
+void compactRecordLabels(AccessHistory* accessHistory) {
+  accessHistory->compactRecordLabels();
+#ifdef PERFORMANCE
+  gPerformanceCounters.bumpNumCompactRecordLabels();
+#endif
+}
+
 // iterate over access records in accessHistory, make access history managemnet decision 
 // This function is called with read lock held. ALso, this function being callled implies that 
 // there is no race condition between current access record and all existing history records. 
 // In this function, we determine what could be pruned and update record state.
 // Return true if we need to rollback the calculation
-bool manageAccessRecords(AccessHistory* accessHistory, const Record& currentRecord, ReaderWriterLockGuard& lockGuard, std::vector<RecordManagementInfo>& info) {
+/*
+ * Remove the records made redundant by the current record and add the 
+ * current record, based on the management info computed from the records
+ * at `version`. Return true if the records changed while upgrading to the
+ * writer lock, then the caller has to check the records again. The writer 
+ * lock is held from then on, so this happens at most once per access.
+ */
+bool manageAccessRecords(AccessHistory* accessHistory, const Record& currentRecord, ReaderWriterLockGuard& lockGuard, uint32_t version, std::vector<RecordManagementInfo>& info) {
   auto records = accessHistory->getRecords();
   auto infoSize = info.size(); 
   auto recordsNum = records->size();
@@ -557,9 +593,11 @@ bool manageAccessRecords(AccessHistory* accessHistory, const Record& currentReco
   auto histWriteCurWriteSiblingCurLockSetContainsHistLockSetCount = 0;
   auto histReadCurWriteSiblingCurLockSetContainsHistLockSetCount = 0;
   auto canSkipAddingCurrentRecord = false;
+  auto canCompactRecordLabels = false;
 
   for (int i = 0; i < infoSize; ++i) {
     auto recordManagementInfo = info.at(i);
+    canCompactRecordLabels |= recordManagementInfo.canCompactLabel;
     auto historyRecord = records->at(i); 
     auto historyAccessIsWrite = historyRecord.isWrite();
     auto currentAccessIsWrite = currentRecord.isWrite();
@@ -592,13 +630,18 @@ bool manageAccessRecords(AccessHistory* accessHistory, const Record& currentReco
       canSkipAddingCurrentRecord = true; 
     } 
   }
+  if (recordRemovalCandidates.size() > 0 || !canSkipAddingCurrentRecord) {
+    lockGuard.upgradeFromReaderToWriter();
+    if (accessHistory->getVersion() != version) {
+      return true; // the management info is stale
+    }
+  }
   if (recordRemovalCandidates.size() > 0) {
-    auto hasWriteWriteContention = lockGuard.upgradeFromReaderToWriter();
-    if (!hasWriteWriteContention) {
-      accessHistory->removeRecords(recordRemovalCandidates);
-    } else {
-      return true; // rolling back 
+    if (canCompactRecordLabels) {
+      compactRecordLabels(accessHistory);
+      canCompactRecordLabels = false;
     }
+    accessHistory->removeRecords(recordRemovalCandidates);
 #ifdef PERFORMANCE
     gPerformanceCounters.bumpNumAccessHistoryRemoveRecords();
 #endif
@@ -609,41 +652,118 @@ bool manageAccessRecords(AccessHistory* accessHistory, const Record& currentReco
   } 
 #endif
   if (!canSkipAddingCurrentRecord) {
-  // if we should not skip adding current record to the access history, we need to add it to the record no matter 
-  // if there is write write contention or not. 
-    auto hasWriteWriteContention = lockGuard.upgradeFromReaderToWriter();  
-    if (!hasWriteWriteContention) {
-      accessHistory->addRecordToAccessHistory(currentRecord);
-      return false;
-    } else {
-      return true;
+    if (canCompactRecordLabels) {
+      compactRecordLabels(accessHistory);
+    }
+    accessHistory->addRecordToAccessHistory(currentRecord);
+  }
+  return false;
+}
+
+/*
+ * Record the data race between the two accesses, each pair of racing 
+ * instructions is counted and reported once.
+ */
+void recordDataRace(const Record& histRecord, const Record& curRecord) {
+  auto instnAddrPrev = histRecord.getInstructionAddress();
+  auto instnAddrCur = curRecord.getInstructionAddress();
+  auto memAddr = curRecord.getCheckedMemoryAddress();
+  if (!gDataRaceRecords.recordDataRace(instnAddrPrev, instnAddrCur, memAddr)) {
+    return;
+  }
+  gNumDataRace.fetch_add(1, std::memory_order_relaxed);
+  if (gReportAtRuntime) {
+    reportDataRace(instnAddrPrev, instnAddrCur, memAddr);
+  }
+}
+
+/*
+ * Analyze the records of a long access history in two passes. The first pass
+ * only analyzes the records that could race with the current access judging 
+ * from their access flags, so a data race is found without analyzing the 
+ * other records. The second pass fills in the management info of the other 
+ * records. A record with the same access context as the record analyzed 
+ * before it in the same pass reuses its result. Management info is stored 
+ * by record index, in the order manageAccessRecords expects.
+ */
+bool checkDataRaceForLongAccessHistory(AccessHistory* accessHistory, const Record& currentRecord, ParallelRegionData* parallelRegionData, std::vector<RecordManagementInfo>& info) {
+  auto records = accessHistory->getRecords();
+  auto numRecords = records->size();
+  std::vector<bool> isRaceCandidate(numRecords);
+  for (size_t i = 0; i < numRecords; ++i) {
+    isRaceCandidate[i] = records->at(i).mayRaceWith(currentRecord);
+  }
+  info.resize(numRecords);
+#ifdef PERFORMANCE
+  uint64_t numAccessRecordsTraversed = 0;
+  uint64_t numAnalysesReused = 0;
+#endif
+  for (int pass = 0; pass < 2; ++pass) {
+    auto shouldBeRaceCandidate = pass == 0;
+    const Record* lastRecord = nullptr;
+    RecordManagementInfo lastInfo;
+    for (size_t i = 0; i < numRecords; ++i) {
+      if (isRaceCandidate[i] != shouldBeRaceCandidate) {
+        continue;
+      }
+#ifdef PERFORMANCE
+      numAccessRecordsTraversed += 1;
+#endif
+      const auto& histRecord = records->at(i);
+      if (lastRecord && histRecord.hasSameAccessContext(*lastRecord)) {
+        // the last record did not race either
+        info[i] = lastInfo;
+#ifdef PERFORMANCE
+        numAnalysesReused++;
+#endif
+        continue;
+      }
+      if (analyzeRaceCondition(histRecord, currentRecord, parallelRegionData, info[i])) {
+        accessHistory->setFlag(eDataRaceFound); 
+        recordDataRace(histRecord, currentRecord);
+#ifdef PERFORMANCE
+        gPerformanceCounters.bumpNumTotalAccessRecordsTraversed(numAccessRecordsTraversed);
+        gPerformanceCounters.bumpNumAccessRecordAnalysesReused(numAnalysesReused);
+#endif
+        return true;
+      }
+      lastRecord = &histRecord;
+      lastInfo = info[i];
     }
   }
+#ifdef PERFORMANCE
+  gPerformanceCounters.bumpNumTotalAccessRecordsTraversed(numAccessRecordsTraversed);
+  gPerformanceCounters.bumpNumAccessRecordAnalysesReused(numAnalysesReused);
+#endif
   return false;
 }
 
 // return true if there is data race. 
-bool checkDataRaceForMemoryAddress(uint64_t checkedAddress, AccessHistory* accessHistory, const Record& currentRecord, std::vector<RecordManagementInfo>& info) {
+bool checkDataRaceForMemoryAddress(uint64_t checkedAddress, AccessHistory* accessHistory, const Record& currentRecord, ParallelRegionData* parallelRegionData, std::vector<RecordManagementInfo>& info) {
   auto records = accessHistory->getRecords();
+  if (records->size() >= LONG_ACCESS_HISTORY_THRESHOLD) {
+    return checkDataRaceForLongAccessHistory(accessHistory, currentRecord, parallelRegionData, info);
+  }
   auto dataRaceFound = false;
 #ifdef PERFORMANCE
   uint64_t numAccessRecordsTraversed = 0;
 #endif
   for (int i = 0; i < records->size(); ++i) { 
-    auto histRecord = records->at(i);
+    const auto& histRecord = records->at(i);
     RecordManagementInfo recordManagementInfo;      
 #ifdef PERFORMANCE
     numAccessRecordsTraversed += 1;
 #endif
-    if (analyzeRaceCondition(histRecord, currentRecord, recordManagementInfo)) {
+    if (analyzeRaceCondition(histRecord, currentRecord, parallelRegionData, recordManagementInfo)) {
       accessHistory->setFlag(eDataRaceFound); 
+      recordDataRace(histRecord, currentRecord);
       dataRaceFound = true;
       break;
     }
     info.push_back(recordManagementInfo); 
   }
 #ifdef PERFORMANCE
-  gPerformanceCounters.bumpNumTotalAccessRecordsTraversed(numAccessRecordsTraversed); 
+  gPerformanceCounters.bumpNumTotalAccessRecordsTraversed(numAccessRecordsTraversed);
 #endif
   return dataRaceFound;
 }
@@ -0,0 +1,79 @@
+#include "DataRaceTable.h"
+
+#include <glog/logging.h>
+#include <glog/raw_logging.h>
+
+#include "lock-wait.h"
+
+void DataRaceTable::init(uint64_t capacity) {
+  if (capacity == 0) {
+    capacity = DATA_RACE_TABLE_DEFAULT_CAPACITY;
+  }
+  mCapacity = 1;
+  while (mCapacity < capacity) {
+    mCapacity <<= 1;
+  }
+  mEntries.reset(new DataRaceEntry[mCapacity]);
+  for (uint64_t i = 0; i < mCapacity; ++i) {
+    mEntries[i].state.store(eEntryEmpty, std::memory_order_relaxed);
+  }
+  LOG(INFO) << "data race table capacity: " << mCapacity;
+}
+
+inline bool isSameInstructionPair(const DataRaceInfo& info, void* first, void* second) {
+  return (info.instnAddrPrev == first && info.instnAddrCur == second) ||
+         (info.instnAddrPrev == second && info.instnAddrCur == first);
+}
+
+/*
+ * Return true if the instruction pair is recorded for the first time. 
+ * Entries are probed linearly from the hash of the unordered pair.
+ */
+bool DataRaceTable::recordDataRace(void* instnAddrPrev, void* instnAddrCur, uint64_t memAddr) {
+  if (mCapacity == 0) {
+    return false;
+  }
+  auto first = reinterpret_cast<uint64_t>(instnAddrPrev);
+  auto second = reinterpret_cast<uint64_t>(instnAddrCur);
+  auto hash = (first ^ second) * 0x9e3779b97f4a7c15ULL + (first + second);
+  auto index = hash & (mCapacity - 1);
+  for (uint64_t i = 0; i < mCapacity; ++i) {
+    auto& entry = mEntries[index];
+    uint64_t state = entry.state.load(std::memory_order_acquire);
+    if (state == eEntryEmpty) {
+      if (entry.state.compare_exchange_strong(state, eEntryWriting, std::memory_order_acquire)) {
+        entry.info = DataRaceInfo(instnAddrPrev, instnAddrCur, memAddr);
+        entry.state.store(eEntryPublished, std::memory_order_release);
+        return true;
+      }
+    }
+    // another thread is recording in this entry, wait for its pair
+    while (state == eEntryWriting) {
+      lock_cpu_relax();
+      state = entry.state.load(std::memory_order_acquire);
+    }
+    if (isSameInstructionPair(entry.info, instnAddrPrev, instnAddrCur)) {
+      return false;
+    }
+    index = (index + 1) & (mCapacity - 1);
+  }
+  mNumDroppedDataRaces.fetch_add(1, std::memory_order_relaxed);
+  return false;
+}
+
+/*
+ * Collect the recorded data races, called after the program finishes.
+ */
+std::vector<DataRaceInfo> DataRaceTable::getDataRaces() const {
+  std::vector<DataRaceInfo> dataRaces;
+  for (uint64_t i = 0; i < mCapacity; ++i) {
+    if (mEntries[i].state.load(std::memory_order_acquire) == eEntryPublished) {
+      dataRaces.push_back(mEntries[i].info);
+    }
+  }
+  return dataRaces;
+}
+
+uint64_t DataRaceTable::getNumDroppedDataRaces() const {
+  return mNumDroppedDataRaces.load(std::memory_order_relaxed);
+}
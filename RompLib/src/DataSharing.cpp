@@ -20,14 +20,13 @@
 extern PerformanceCounters gPerformanceCounters; 
 
 bool shouldCheckMemoryAccess(const ThreadInfo& threadInfo, 
-                             const TaskMemoryInfo& taskMemoryInfo,
+                             const TaskAddressBounds& taskAddressBounds,
                              const TaskInfo& taskInfo,
                              const uint64_t memoryAddress,
-                             const ompt_frame_t* taskFrame,
                              DataSharingType& dataSharingType,
                              const bool isWrite,
                              void* instructionAddress) {
-  dataSharingType = analyzeDataSharingType(threadInfo, taskMemoryInfo, memoryAddress, taskFrame);
+  dataSharingType = analyzeDataSharingType(threadInfo, taskAddressBounds, memoryAddress);
   if (isDuplicateMemoryAccess(memoryAddress, taskInfo, isWrite)) {
     return false;
   }
@@ -50,10 +49,13 @@ bool isDuplicateMemoryAccess(const uint64_t memoryAddress, const TaskInfo& taskI
   return true;
 }
 
+/*
+ * The address bounds are captured with the runtime context once the thread
+ * starts or switches tasks, so the analysis only compares addresses.
+ */
 DataSharingType analyzeDataSharingType(const ThreadInfo& threadInfo, 
-                                       const TaskMemoryInfo& taskMemoryInfo,
-                                       const uint64_t memoryAddress,
-                                       const ompt_frame_t* taskFrame) {
+                                       const TaskAddressBounds& taskAddressBounds,
+                                       const uint64_t memoryAddress) {
   // This function tries to infer data sharing property of the memory access to memoryAddress. 
   if (threadInfo.threadType == ompt_thread_other || threadInfo.threadType == ompt_thread_unknown) {
     // not worker thread that executes the program.
@@ -62,46 +64,36 @@ DataSharingType analyzeDataSharingType(const ThreadInfo& threadInfo,
   if (threadInfo.threadType == ompt_thread_initial) {
     return eInitialThread; // we don't check memory accesses performed by initial thread 
   }
-  if (!taskFrame || taskFrame->exit_frame.ptr == nullptr) {
+  if (taskAddressBounds.exitFrameAddress == 0) {
     return eUnknown;
   } 
-
-  const auto threadData = threadInfo.threadData;
-  if (threadData == nullptr || 
-      threadData->stackBaseAddress == nullptr || 
-      threadData->stackTopAddress == nullptr) {
+  if (taskAddressBounds.stackBaseAddress == 0 || taskAddressBounds.stackTopAddress == 0) {
     // memory access is checked when thread has not called the thread begin callback yet.
     return eUnknown;  
   }
-  if (memoryAddress > reinterpret_cast<const uint64_t>(threadData->stackTopAddress) ||
-      memoryAddress < reinterpret_cast<const uint64_t>(threadData->stackBaseAddress)) {
+  if (memoryAddress > taskAddressBounds.stackTopAddress || memoryAddress < taskAddressBounds.stackBaseAddress) {
     // memory address does not fall in current thread stack range 
-    if (taskMemoryInfo.blockAddress != nullptr) {
-      // check if the memory access is explicit task private 
-      const auto taskPrivateMemoryBaseAddress = reinterpret_cast<const uint64_t>(taskMemoryInfo.blockAddress);
-      const auto taskPrivateMemorySize = reinterpret_cast<const uint64_t>(taskMemoryInfo.blockSize);
-      if (memoryAddress >= taskPrivateMemoryBaseAddress && memoryAddress <= taskPrivateMemoryBaseAddress + taskPrivateMemorySize) {
-        // filter explicit task private memory locations. Memory accesses to these locations should be exclusive to the task. 
-        return eExplicitTaskPrivate;
-      }
+    if (taskAddressBounds.taskPrivateBaseAddress != 0 && 
+        memoryAddress >= taskAddressBounds.taskPrivateBaseAddress && 
+        memoryAddress <= taskAddressBounds.taskPrivateEndAddress) {
+      // filter explicit task private memory locations. Memory accesses to these locations should be exclusive to the task. 
+      return eExplicitTaskPrivate;
     }
-    const auto taskPrivateMemoryBaseAddress = reinterpret_cast<const uint64_t>(taskMemoryInfo.blockAddress);
-    RAW_DLOG(INFO, "?????? analyze data sharing type: mem: %lx stack top: %lx stack bottom: %lx private base: %lx ", memoryAddress, threadData->stackTopAddress, threadData->stackBaseAddress, taskPrivateMemoryBaseAddress);
     return eNonThreadPrivate;
   }
   // now the memory access is within current thread's stack range. We want to figure out if the memory access is task private.
-  auto enterFrame = taskFrame->enter_frame;
-  auto exitFrame = taskFrame->exit_frame;
-  // exitFrame.ptr is the upper bound of the current task's scratch space. 
-  // enterFrame.ptr is set if current task creates children explicit tasks, if it is not set, enterFrame.ptr = 0
-  if (enterFrame.ptr > exitFrame.ptr) {
+  // exit frame is the upper bound of the current task's scratch space. 
+  // enter frame is set if current task creates children explicit tasks, if it is not set, it is 0
+  auto enterFrameAddress = taskAddressBounds.enterFrameAddress;
+  auto exitFrameAddress = taskAddressBounds.exitFrameAddress;
+  if (enterFrameAddress > exitFrameAddress) {
     // enter frame is higher than exit frame  
-    if (memoryAddress <= reinterpret_cast<const uint64_t>(exitFrame.ptr)) {
+    if (memoryAddress <= exitFrameAddress) {
       return eThreadPrivateAccessCurrentTask;
     }  else {
       return eThreadPrivateAccessOtherTask; 
     } 
-  } else if (memoryAddress <= reinterpret_cast<const uint64_t>(exitFrame.ptr) && memoryAddress >= reinterpret_cast<const uint64_t>(enterFrame.ptr)) {
+  } else if (memoryAddress <= exitFrameAddress && memoryAddress >= enterFrameAddress) {
     return eThreadPrivateAccessCurrentTask;
   } else {
     return eThreadPrivateAccessOtherTask;
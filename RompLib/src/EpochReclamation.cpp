@@ -0,0 +1,78 @@
+#include "EpochReclamation.h"
+
+#include <atomic>
+#include <glog/logging.h>
+#include <glog/raw_logging.h>
+
+#define INACTIVE_EPOCH 0
+
+/*
+ * One slot per thread that has entered a read section. Slots are never
+ * freed, a slot released by an exiting thread is reused by the next thread.
+ */
+typedef struct EpochSlot {
+  std::atomic<uint64_t> announcedEpoch;
+  std::atomic<bool> inUse;
+  EpochSlot* next;
+} EpochSlot;
+
+static std::atomic<uint64_t> gReclamationEpoch(1);
+static std::atomic<EpochSlot*> gEpochSlots(nullptr);
+
+static EpochSlot* acquireSlot() {
+  for (auto slot = gEpochSlots.load(std::memory_order_acquire); slot; slot = slot->next) {
+    auto inUse = false;
+    if (!slot->inUse.load(std::memory_order_relaxed) && 
+        slot->inUse.compare_exchange_strong(inUse, true)) {
+      return slot;
+    }
+  }
+  auto slot = new EpochSlot();
+  slot->announcedEpoch.store(INACTIVE_EPOCH, std::memory_order_relaxed);
+  slot->inUse.store(true, std::memory_order_relaxed);
+  slot->next = gEpochSlots.load(std::memory_order_relaxed);
+  while (!gEpochSlots.compare_exchange_weak(slot->next, slot, std::memory_order_release, std::memory_order_relaxed));
+  return slot;
+}
+
+class ThreadEpochSlot {
+public:
+  ThreadEpochSlot() : mSlot(acquireSlot()) {}
+  ~ThreadEpochSlot() {
+    mSlot->announcedEpoch.store(INACTIVE_EPOCH, std::memory_order_release);
+    mSlot->inUse.store(false, std::memory_order_release);
+  }
+  EpochSlot* get() const { return mSlot; }
+private:
+  EpochSlot* mSlot;
+};
+
+static thread_local ThreadEpochSlot tEpochSlot;
+
+EpochReadGuard::EpochReadGuard() {
+  auto slot = tEpochSlot.get();
+  slot->announcedEpoch.store(gReclamationEpoch.load(std::memory_order_relaxed), std::memory_order_relaxed);
+  // the announcement must be visible before any shared object is read
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+}
+
+EpochReadGuard::~EpochReadGuard() {
+  tEpochSlot.get()->announcedEpoch.store(INACTIVE_EPOCH, std::memory_order_release);
+}
+
+uint64_t advanceReclamationEpoch() {
+  // unpublishing of retired objects must be visible before the epoch advances
+  return gReclamationEpoch.fetch_add(1, std::memory_order_seq_cst);
+}
+
+uint64_t getOldestActiveReclamationEpoch() {
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  auto oldestEpoch = UINT64_MAX;
+  for (auto slot = gEpochSlots.load(std::memory_order_acquire); slot; slot = slot->next) {
+    auto epoch = slot->announcedEpoch.load(std::memory_order_acquire);
+    if (epoch != INACTIVE_EPOCH && epoch < oldestEpoch) {
+      oldestEpoch = epoch;
+    }
+  }
+  return oldestEpoch;
+}
@@ -1,4 +1,5 @@
 #include "Label.h"
+#include "PoolAllocator.h"
 #include "TaskData.h"
 
 #include <glog/logging.h>
@@ -10,7 +11,15 @@
  * will be affected.
  */
 Label::Label(const Label& label) {
-  mLabel = label.mLabel; 
+  // almost every copy is followed by appending a segment, reserve room for it
+  mLabel.reserve(label.mLabel.size() + 1);
+  mLabel.assign(label.mLabel.begin(), label.mLabel.end()); 
+  mRegionSummary = label.mRegionSummary;
+}
+
+void RegionSummary::setJoinedLabel(const std::shared_ptr<Label>& label) {
+  mJoinedLabel = label;
+  mIsJoined.store(true, std::memory_order_release);
 }
 
 inline std::shared_ptr<BaseSegment> Clone(BaseSegment* segment) {
@@ -50,6 +59,32 @@ std::string Label::toFieldsBreakdown() const {
   return result;
 }
 
+/*
+ * Encode the label as a varint stream: the number of words of a segment 
+ * value, which tells the compact and the wide segment layout apart, the 
+ * number of segments, then each segment's encoding.
+ */
+void Label::encode(std::vector<uint8_t>& buffer) const {
+  encodeVarint(SegmentLayout::kNumWords, buffer);
+  encodeVarint(mLabel.size(), buffer);
+  for (const auto& segment : mLabel) {
+    segment->encode(buffer);
+  }
+}
+
+std::string Label::toHexEncoding() const {
+  static const char* kHexDigits = "0123456789abcdef";
+  std::vector<uint8_t> buffer;
+  encode(buffer);
+  std::string result;
+  result.reserve(buffer.size() * 2);
+  for (auto byte : buffer) {
+    result.push_back(kHexDigits[byte >> 4]);
+    result.push_back(kHexDigits[byte & 0xf]);
+  }
+  return result;
+}
+
 void Label::appendSegment(const std::shared_ptr<BaseSegment>& segment) {
   mLabel.push_back(segment);
 }
@@ -92,6 +127,39 @@ int Label::getLabelLength() const {
   return mLabel.size();
 }
 
+const std::shared_ptr<RegionSummary>& Label::getRegionSummary() const {
+  return mRegionSummary;
+}
+
+void Label::setRegionSummary(const std::shared_ptr<RegionSummary>& regionSummary) {
+  mRegionSummary = regionSummary;
+}
+
+/*
+ * Return the shallowest label that has the same happens-before relation 
+ * as `label` with any access performed after now. If the parallel regions 
+ * `label` was created in have ended, this is the joined label of the 
+ * outermost ended region. Otherwise it is `label` itself.
+ */
+Label* getCompactLabel(Label* label) {
+  auto regionSummary = label->getRegionSummary().get();
+  while (regionSummary && regionSummary->isJoined()) {
+    label = regionSummary->getJoinedLabel().get();
+    regionSummary = label->getRegionSummary().get();
+  }
+  return label;
+}
+
+std::shared_ptr<Label> getCompactLabel(const std::shared_ptr<Label>& label) {
+  auto result = label;
+  auto regionSummary = label->getRegionSummary().get();
+  while (regionSummary && regionSummary->isJoined()) {
+    result = regionSummary->getJoinedLabel();
+    regionSummary = result->getRegionSummary().get();
+  }
+  return result;
+}
+
 // This function performs label comparison.
 int compareLabels(Label* left, Label* right) {
   auto& leftLabel = left->mLabel;
@@ -114,14 +182,64 @@ int compareLabels(Label* left, Label* right) {
   return static_cast<int>(eRightIsPrefix);
 }
 
+/*
+ * Decode a label produced by Label::encode. Return nullptr if the data is 
+ * malformed or was encoded with a different segment layout.
+ */
+std::shared_ptr<Label> decodeLabel(const uint8_t* data, size_t size) {
+  auto cursor = data;
+  auto end = data + size;
+  uint64_t numWords, numSegments;
+  if (!decodeVarint(cursor, end, numWords) || numWords != SegmentLayout::kNumWords) {
+    return nullptr;
+  }
+  if (!decodeVarint(cursor, end, numSegments)) {
+    return nullptr;
+  }
+  auto label = makePoolShared<Label>();
+  for (uint64_t i = 0; i < numSegments; ++i) {
+    auto segment = BaseSegment::decode(cursor, end);
+    if (!segment) {
+      return nullptr;
+    }
+    label->appendSegment(segment);
+  }
+  return cursor == end ? label : nullptr;
+}
+
+std::shared_ptr<Label> decodeLabelFromHex(const std::string& hex) {
+  if (hex.size() % 2 != 0) {
+    return nullptr;
+  }
+  std::vector<uint8_t> buffer;
+  for (size_t i = 0; i < hex.size(); i += 2) {
+    auto byte = 0;
+    for (size_t j = i; j < i + 2; ++j) {
+      auto c = hex[j];
+      byte <<= 4;
+      if (c >= '0' && c <= '9') {
+        byte |= c - '0';
+      } else if (c >= 'a' && c <= 'f') {
+        byte |= c - 'a' + 10;
+      } else if (c >= 'A' && c <= 'F') {
+        byte |= c - 'A' + 10;
+      } else {
+        return nullptr;
+      }
+    }
+    buffer.push_back(static_cast<uint8_t>(byte));
+  }
+  return decodeLabel(buffer.data(), buffer.size());
+}
+
 std::shared_ptr<Label> generateImplicitTaskLabel(
                            Label* parentLabel,
                            unsigned int index,
                            unsigned int actualParallelism) {
   // create the new label by copy constructing from parent label
-  auto newLabel = std::make_shared<Label>(*parentLabel);
+  auto newLabel = makePoolShared<Label>(*parentLabel);
   // create a new label segment
-  auto newSegment = std::make_shared<BaseSegment>(eImplicit, 
+  auto newSegment = makePoolShared<BaseSegment>(eImplicit, 
           static_cast<uint64_t>(index), 
           static_cast<uint64_t>(actualParallelism));
   newLabel->appendSegment(newSegment);
@@ -129,8 +247,8 @@ std::shared_ptr<Label> generateImplicitTaskLabel(
 }
 
 std::shared_ptr<Label> generateInitialTaskLabel() {
-  auto label = std::make_shared<Label>();
-  auto segment = std::make_shared<BaseSegment>(eImplicit, 0, 1);
+  auto label = makePoolShared<Label>();
+  auto segment = makePoolShared<BaseSegment>(eImplicit, 0, 1);
   label->appendSegment(segment);
   return label;
 }
@@ -139,15 +257,18 @@ std::shared_ptr<Label> generateInitialTaskLabel() {
  * Given the parent task label, generate the label for the explicit task.
  */
 std::shared_ptr<Label> generateExplicitTaskLabel(Label* parentLabel, void* taskDataPtr) {
-  auto newLabel = std::make_shared<Label>(*parentLabel);
-  auto segment = std::make_shared<ExplicitTaskSegment>(taskDataPtr); 
+  auto newLabel = makePoolShared<Label>(*parentLabel);
+  auto segment = makePoolShared<ExplicitTaskSegment>(taskDataPtr); 
   newLabel->appendSegment(segment);
   return newLabel;
 }
 
 std::shared_ptr<Label> mutateParentImpEnd(Label* childLabel) {
-  auto newLabel = std::make_shared<Label>(*childLabel);
+  auto newLabel = makePoolShared<Label>(*childLabel);
   newLabel->popSegment();       
+  // the parent task continues in the enclosing parallel region
+  auto& regionSummary = childLabel->getRegionSummary();
+  newLabel->setRegionSummary(regionSummary ? regionSummary->getEnclosing() : nullptr);
   return newLabel;
 }
 
@@ -157,7 +278,7 @@ std::shared_ptr<Label> mutateParentImpEnd(Label* childLabel) {
  */
 std::shared_ptr<Label> mutateParentTaskCreate(Label* parentLabel) {
   RAW_DLOG(INFO, "mutate parnet task create");
-  auto newLabel = std::make_shared<Label>(*parentLabel);  
+  auto newLabel = makePoolShared<Label>(*parentLabel);  
   auto lastSegment = newLabel->popSegment();
   auto taskCreate = lastSegment->getTaskcreate();
   auto newSegment = Clone(lastSegment.get());
@@ -172,14 +293,11 @@ std::shared_ptr<Label> mutateParentTaskCreate(Label* parentLabel) {
  * the second last segment of the label.
  */
 std::shared_ptr<Label> mutateBarrierEnd(Label* label) {
-  auto newLabel = std::make_shared<Label>(*label);
+  auto newLabel = makePoolShared<Label>(*label);
   auto segment = newLabel->getLastKthSegment(2); //get the second last segment
-  uint64_t offset, span; 
-  segment->getOffsetSpan(offset, span); //get the offset and span value
-  offset += span;
   //because we don't know the actual derived type of segment, should do a clone
   auto newSegment = Clone(segment.get());
-  newSegment->setOffsetSpan(offset, span); //set the new offset and span
+  newSegment->advanceOffsetBySpan(); //add span to the offset
   newLabel->setLastKthSegment(2, newSegment); 
   return newLabel; 
 } 
@@ -190,7 +308,7 @@ std::shared_ptr<Label> mutateBarrierEnd(Label* label) {
  * field counter in the last label segment
  */ 
 std::shared_ptr<Label> mutateTaskWait(Label* label) {
-  auto newLabel = std::make_shared<Label>(*label);
+  auto newLabel = makePoolShared<Label>(*label);
   auto lastSegment = newLabel->popSegment(); // replace the last segment
   auto taskwait = lastSegment->getTaskwait();
   taskwait += 1;
@@ -206,7 +324,7 @@ std::shared_ptr<Label> mutateTaskWait(Label* label) {
  * the `phase` counter value by one.
  */
 std::shared_ptr<Label> mutateOrderSection(Label* label) {
-  auto newLabel = std::make_shared<Label>(*label);
+  auto newLabel = makePoolShared<Label>(*label);
   auto lastSegment = newLabel->popSegment(); // replace the last segment
   auto phase = lastSegment->getPhase();
   phase += 1;
@@ -221,8 +339,8 @@ std::shared_ptr<Label> mutateOrderSection(Label* label) {
  * to mark the begin of the workshare loop.
  */
 std::shared_ptr<Label> mutateLoopBegin(Label* label) {
-  auto newLabel = std::make_shared<Label>(*label); 
-  auto newSegment = std::make_shared<WorkShareSegment>(); 
+  auto newLabel = makePoolShared<Label>(*label); 
+  auto newSegment = makePoolShared<WorkShareSegment>(); 
   newSegment->toggleWorkSharePlaceHolderFlag();
   newLabel->appendSegment(newSegment);   
   return newLabel;
@@ -234,7 +352,7 @@ std::shared_ptr<Label> mutateLoopBegin(Label* label) {
  * segment by one (should replace the old one)
  */
 std::shared_ptr<Label> mutateLoopEnd(Label* label) {
-  auto newLabel = std::make_shared<Label>(*label); 
+  auto newLabel = makePoolShared<Label>(*label); 
   newLabel->popSegment();
   auto segment = newLabel->popSegment();
   auto loopCount = segment->getLoopCount();
@@ -258,7 +376,7 @@ std::shared_ptr<Label> mutateSectionEnd(Label* label) {
 }
 
 std::shared_ptr<Label> mutateSingleExecutor(Label* label) {
-  auto newLabel = std::make_shared<Label>(*label); 
+  auto newLabel = makePoolShared<Label>(*label); 
   auto segment = newLabel->getLastKthSegment(1); 
   auto newSegment = Clone(segment.get());
   newSegment->toggleSingleExecutor(); 
@@ -267,7 +385,7 @@ std::shared_ptr<Label> mutateSingleExecutor(Label* label) {
 }
 
 std::shared_ptr<Label> mutateSingleOther(Label* label) {
-  auto newLabel = std::make_shared<Label>(*label); 
+  auto newLabel = makePoolShared<Label>(*label); 
   auto segment = newLabel->getLastKthSegment(1); 
   auto newSegment = Clone(segment.get());
   newSegment->toggleSingleOther(); 
@@ -284,10 +402,10 @@ std::shared_ptr<Label> mutateSingleOther(Label* label) {
  * proper workshare segment.
  */
 std::shared_ptr<Label> mutateLogicalDispatch(Label* label, uint64_t id, WorkShareType workShareType) {
-  auto newLabel = std::make_shared<Label>(*label); 
+  auto newLabel = makePoolShared<Label>(*label); 
   auto segment = newLabel->popSegment();
   RAW_DCHECK(segment->getType() == eLogical, "not a workshare segment");
-  auto newSegment = std::make_shared<WorkShareSegment>(id, workShareType); 
+  auto newSegment = makePoolShared<WorkShareSegment>(id, workShareType); 
   newLabel->appendSegment(newSegment);   
   return newLabel;
 }
@@ -306,7 +424,7 @@ std::shared_ptr<Label> mutateSectionDispatch(Label* label, void* id) {
  * task group id by one
  */
 std::shared_ptr<Label> mutateTaskGroupBegin(Label* label) {
- auto newLabel = std::make_shared<Label>(*label);      
+ auto newLabel = makePoolShared<Label>(*label);      
  auto segment = newLabel->popSegment();
  auto taskGroupId = segment->getTaskGroupId();
  taskGroupId += 1;
@@ -325,7 +443,7 @@ std::shared_ptr<Label> mutateTaskGroupBegin(Label* label) {
  * the task group id by one
  */
 std::shared_ptr<Label> mutateTaskGroupEnd(Label* label) {
-  auto newLabel = std::make_shared<Label>(*label);
+  auto newLabel = makePoolShared<Label>(*label);
   auto segment = newLabel->popSegment();
   auto taskGroupId = segment->getTaskGroupId();
   taskGroupId += 1;
@@ -348,7 +466,7 @@ std::shared_ptr<Label> mutateTaskComplete(Label* label) {
   if (!label) {
     return nullptr;
   }
-  auto newLabel = std::make_shared<Label>(*label);
+  auto newLabel = makePoolShared<Label>(*label);
   auto lastSeg = newLabel->popSegment();       
   auto lastSegType = lastSeg->getType(); 
   RAW_CHECK(lastSegType == eExplicit, "last segment should be explicit");
@@ -360,7 +478,7 @@ std::shared_ptr<Label> mutateTaskComplete(Label* label) {
  * taskgroup construct finishes. Set the taskgroup sync mark.
  */
 std::shared_ptr<Label> mutateTaskGroupSyncChild(Label* label) {
-  auto newLabel = std::make_shared<Label>(*label); 
+  auto newLabel = makePoolShared<Label>(*label); 
   auto lastSeg = newLabel->getLastKthSegment(1);
   lastSeg->setTaskGroupSync();
   return newLabel;
@@ -3,38 +3,116 @@
 #include <algorithm>
 #include <glog/logging.h>
 #include <glog/raw_logging.h>
+#include <sstream>
+
+inline uint64_t getLockSignature(uint64_t lock) {
+  // fibonacci hashing, take the top 6 bits as the bit index
+  return 1ULL << ((lock * 0x9e3779b97f4a7c15ULL) >> 58);
+}
 
 std::string LockSet::toString() const {
   std::stringstream stream;
-  for (std::pair<uint64_t, uint64_t> element : mLock) {
-    stream << std::hex << element.first << "|";
+  for (auto it = begin(); it != end(); ++it) {
+    stream << std::hex << *it << "|";
   }
   auto result = "<" + stream.str() + ">";
   return result;
 }
 
 LockSet::LockSet(const LockSet& lockSet) {
-  for (std::pair<uint64_t, uint64_t> element : lockSet.mLock) {
-    mLock[element.first] = element.second;
+  mId = 0; // a copy is not interned
+  mNumLocks = lockSet.mNumLocks;
+  mSignature = lockSet.mSignature;
+  if (mNumLocks > LOCKSET_INLINE_CAPACITY) {
+    mOverflowLocks = lockSet.mOverflowLocks;
+  } else {
+    std::copy(lockSet.mInlineLocks, lockSet.mInlineLocks + mNumLocks, mInlineLocks);
   }
 }
 
+const uint64_t* LockSet::begin() const {
+  return mNumLocks > LOCKSET_INLINE_CAPACITY ? mOverflowLocks.data() : mInlineLocks;
+}
+
+const uint64_t* LockSet::end() const {
+  return begin() + mNumLocks;
+}
+
+void LockSet::updateSignature() {
+  mSignature = 0;
+  for (auto it = begin(); it != end(); ++it) {
+    mSignature |= getLockSignature(*it);
+  }
+}
+
+bool LockSet::operator==(const LockSet& other) const {
+  return mNumLocks == other.mNumLocks && std::equal(begin(), end(), other.begin());
+}
+
+uint64_t LockSet::hash() const {
+  uint64_t result = mNumLocks;
+  for (auto it = begin(); it != end(); ++it) {
+    result = (result ^ *it) * 0x100000001b3ULL;
+  }
+  return result;
+}
+
 bool LockSet::isEmpty() const {
-  return mLock.empty();
+  return mNumLocks == 0;
 }
 
 void LockSet::addLock(uint64_t lock) {
-  mLock[lock] = 1; 
+  auto position = std::lower_bound(begin(), end(), lock);
+  if (position != end() && *position == lock) {
+    return;
+  }
+  auto index = position - begin();
+  if (mNumLocks < LOCKSET_INLINE_CAPACITY) {
+    std::copy_backward(mInlineLocks + index, mInlineLocks + mNumLocks, mInlineLocks + mNumLocks + 1);
+    mInlineLocks[index] = lock;
+  } else {
+    if (mNumLocks == LOCKSET_INLINE_CAPACITY) {
+      // spill the inline locks to the heap
+      mOverflowLocks.assign(mInlineLocks, mInlineLocks + mNumLocks);
+    }
+    mOverflowLocks.insert(mOverflowLocks.begin() + index, lock);
+  }
+  mNumLocks++;
+  mSignature |= getLockSignature(lock);
 }
 
 void LockSet::removeLock(uint64_t lock) {
-  mLock.erase(lock); 
+  auto position = std::lower_bound(begin(), end(), lock);
+  if (position == end() || *position != lock) {
+    return;
+  }
+  auto index = position - begin();
+  if (mNumLocks > LOCKSET_INLINE_CAPACITY) {
+    mOverflowLocks.erase(mOverflowLocks.begin() + index);
+    if (mNumLocks - 1 == LOCKSET_INLINE_CAPACITY) {
+      std::copy(mOverflowLocks.begin(), mOverflowLocks.end(), mInlineLocks);
+      mOverflowLocks.clear();
+    }
+  } else {
+    std::copy(mInlineLocks + index + 1, mInlineLocks + mNumLocks, mInlineLocks + index);
+  }
+  mNumLocks--;
+  // signature bits may be shared by several locks, recompute
+  updateSignature();
 }
 
 bool hasCommonLockImpl(const LockSet& l1, const LockSet& l2) {
-  for (std::pair<uint64_t, uint64_t> element : l1.mLock) {
-    auto lock = element.first;
-    if (l2.mLock.find(lock) != l2.mLock.end()) {
+  if ((l1.mSignature & l2.mSignature) == 0) {
+    return false;
+  }
+  auto it1 = l1.begin();
+  auto it2 = l2.begin();
+  while (it1 != l1.end() && it2 != l2.end()) {
+    if (*it1 < *it2) {
+      ++it1;
+    } else if (*it2 < *it1) {
+      ++it2;
+    } else {
       return true;
     }
   }
@@ -50,18 +128,13 @@ bool hasCommonLock(LockSet* l1, LockSet* l2) {
 
 // return true if l1 is subset of l2
 bool isSubSetImpl(const LockSet& l1, const LockSet& l2) {
-  auto numLockInL1 = l1.mLock.size(); 
-  auto numLockInL2 = l2.mLock.size(); 
-  if (numLockInL1 > numLockInL2) {
+  if (l1.mNumLocks > l2.mNumLocks) {
     return false;
   }
-  for (std::pair<uint64_t, uint64_t> element : l1.mLock) {
-    auto lock = element.first;
-    if (l2.mLock.find(lock) == l2.mLock.end()) {
-      return false; 
-    }
+  if ((l1.mSignature & ~l2.mSignature) != 0) {
+    return false;
   }
-  return true;
+  return std::includes(l2.begin(), l2.end(), l1.begin(), l1.end());
 }
 
 // return true if l1 is subet of l2 and both l1 and l2 are not null, and are not empty
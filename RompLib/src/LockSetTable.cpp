@@ -0,0 +1,147 @@
+#include "LockSetTable.h"
+
+#include <glog/logging.h>
+#include <glog/raw_logging.h>
+
+#include "AccessControl.h"
+
+// relation cache entry: hist id (24 bits) | cur id (24 bits) | relation (8 bits)
+inline uint64_t makeRelationKey(uint32_t histId, uint32_t curId) {
+  return (static_cast<uint64_t>(histId) << 24) | curId;
+}
+
+inline size_t getRelationSlot(uint64_t key) {
+  return ((key * 0x9e3779b97f4a7c15ULL) >> 32) % LOCK_RELATION_CACHE_SIZE;
+}
+
+inline std::unique_ptr<LockSetSlots> makeTable(uint64_t capacity) {
+  std::unique_ptr<LockSetSlots> table(new LockSetSlots());
+  table->capacity = capacity;
+  table->slots.reset(new std::atomic<LockSet*>[capacity]);
+  for (uint64_t i = 0; i < capacity; ++i) {
+    table->slots[i].store(nullptr, std::memory_order_relaxed);
+  }
+  return table;
+}
+
+// an interned lock set lives as long as the table, the pointer owns nothing
+inline std::shared_ptr<LockSet> makeSharedLockSet(LockSet* lockSet) {
+  return std::shared_ptr<LockSet>(std::shared_ptr<LockSet>(), lockSet);
+}
+
+LockSetTable::LockSetTable() : mNextId(1) {
+  mcs_init(&mInsertLock);
+  mTables.push_back(makeTable(LOCKSET_TABLE_INITIAL_CAPACITY));
+  mTable.store(mTables.back().get(), std::memory_order_relaxed);
+  for (auto& entry : mRelationCache) {
+    entry.store(0, std::memory_order_relaxed);
+  }
+}
+
+std::shared_ptr<LockSet> LockSetTable::addLock(const std::shared_ptr<LockSet>& lockSet, uint64_t lock) {
+  auto newLockSet = lockSet ? LockSet(*lockSet) : LockSet();
+  newLockSet.addLock(lock);
+  return intern(newLockSet);
+}
+
+std::shared_ptr<LockSet> LockSetTable::removeLock(const std::shared_ptr<LockSet>& lockSet, uint64_t lock) {
+  if (!lockSet) {
+    RAW_LOG(WARNING, "release lock %lx which is not held", lock);
+    return nullptr;
+  }
+  auto newLockSet = LockSet(*lockSet);
+  newLockSet.removeLock(lock);
+  return intern(newLockSet);
+}
+
+/*
+ * Probe the current table until the lock set or an empty slot is found. 
+ * Slots are only filled, with release ordering after the lock set is 
+ * complete, so the probe needs no lock.
+ */
+LockSet* LockSetTable::find(const LockSet& lockSet, uint64_t hash) const {
+  auto table = mTable.load(std::memory_order_acquire);
+  auto mask = table->capacity - 1;
+  for (auto i = hash & mask; ; i = (i + 1) & mask) {
+    auto candidate = table->slots[i].load(std::memory_order_acquire);
+    if (candidate == nullptr) {
+      return nullptr;
+    }
+    if (*candidate == lockSet) {
+      return candidate;
+    }
+  }
+}
+
+// called with the insert lock held, the table has an empty slot
+void LockSetTable::insert(LockSetSlots* table, LockSet* lockSet) {
+  auto mask = table->capacity - 1;
+  auto i = lockSet->hash() & mask;
+  while (table->slots[i].load(std::memory_order_relaxed) != nullptr) {
+    i = (i + 1) & mask;
+  }
+  table->slots[i].store(lockSet, std::memory_order_release);
+}
+
+// called with the insert lock held
+void LockSetTable::grow() {
+  auto table = makeTable(2 * mTable.load(std::memory_order_relaxed)->capacity);
+  for (const auto& lockSet : mLockSets) {
+    insert(table.get(), lockSet.get());
+  }
+  mTable.store(table.get(), std::memory_order_release);
+  mTables.push_back(std::move(table));
+}
+
+std::shared_ptr<LockSet> LockSetTable::intern(const LockSet& lockSet) {
+  auto hash = lockSet.hash();
+  auto interned = find(lockSet, hash);
+  if (interned) {
+    return makeSharedLockSet(interned);
+  }
+  mcs_node_t node;
+  LockGuard guard(&mInsertLock, &node, nullptr);
+  // the lock set could be interned by another thread meanwhile
+  interned = find(lockSet, hash);
+  if (interned) {
+    return makeSharedLockSet(interned);
+  }
+  if (mNextId > LOCKSET_TABLE_MAX_ID) {
+    return std::make_shared<LockSet>(lockSet);
+  }
+  mLockSets.emplace_back(new LockSet(lockSet));
+  auto newLockSet = mLockSets.back().get();
+  newLockSet->mId = mNextId++;
+  if (2 * mLockSets.size() > mTable.load(std::memory_order_relaxed)->capacity) {
+    // the new lock set is inserted while rehashing
+    grow();
+  } else {
+    insert(mTable.load(std::memory_order_relaxed), newLockSet);
+  }
+  return makeSharedLockSet(newLockSet);
+}
+
+bool LockSetTable::lookupRelation(const LockSet* histLockSet, const LockSet* curLockSet, LockRelation& lockRelation) const {
+  auto histId = histLockSet->getId();
+  auto curId = curLockSet->getId();
+  if (histId == 0 || curId == 0) {
+    return false;
+  }
+  auto key = makeRelationKey(histId, curId);
+  auto entry = mRelationCache[getRelationSlot(key)].load(std::memory_order_relaxed);
+  if ((entry >> 8) != key) {
+    return false;
+  }
+  lockRelation = static_cast<LockRelation>(entry & 0xff);
+  return true;
+}
+
+void LockSetTable::storeRelation(const LockSet* histLockSet, const LockSet* curLockSet, LockRelation lockRelation) {
+  auto histId = histLockSet->getId();
+  auto curId = curLockSet->getId();
+  if (histId == 0 || curId == 0) {
+    return;
+  }
+  auto key = makeRelationKey(histId, curId);
+  mRelationCache[getRelationSlot(key)].store((key << 8) | static_cast<uint64_t>(lockRelation), std::memory_order_relaxed);
+}
@@ -5,8 +5,10 @@
 
 /*
  * This function maintains task dependence relationship upon task dependence
- * callback. Task dependence forms a directed acyclic graph. 
+ * callback. Task dependence forms a directed acyclic graph. The tasks which
+ * the task depends on are appended to `predecessors`, edges from them are 
+ * added with TaskDependenceGraph::addEdges.
  */
-void ParallelRegionData::maintainTaskDependence(void* taskPtr, const ompt_dependence_t& dependence) {
-  taskDependenceGraph.addDependence(taskPtr, dependence);   
+void ParallelRegionData::maintainTaskDependence(void* taskPtr, const ompt_dependence_t& dependence, std::vector<void*>& predecessors) {
+  taskDependenceGraph.addDependence(taskPtr, dependence, predecessors);   
 }
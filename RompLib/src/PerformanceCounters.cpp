@@ -59,6 +59,67 @@ void PerformanceCounters::bumpNumSkipAddingCurrentRecord() {
   mNumSkipAddingCurrentRecord.fetch_add(1, std::memory_order_relaxed);
 }
 
+void PerformanceCounters::bumpNumCompactRecordLabels() {
+  mNumCompactRecordLabels.fetch_add(1, std::memory_order_relaxed);
+}
+
+void PerformanceCounters::bumpNumTaskDependenceNodesCollected(uint64_t numNodes) {
+  mNumTaskDependenceNodesCollected.fetch_add(numNodes, std::memory_order_relaxed);
+}
+
+void PerformanceCounters::bumpNumCheckDataRaceRetries() {
+  mNumCheckDataRaceRetries.fetch_add(1, std::memory_order_relaxed);
+}
+
+void PerformanceCounters::bumpNumAccessRecordAnalysesReused(uint64_t numAnalyses) {
+  mNumAccessRecordAnalysesReused.fetch_add(numAnalyses, std::memory_order_relaxed);
+}
+
+void PerformanceCounters::bumpNumRuntimeContextRefreshes() {
+  mNumRuntimeContextRefreshes.fetch_add(1, std::memory_order_relaxed);
+}
+
+void PerformanceCounters::bumpNumShadowMemoryAccessSkipped() {
+  mNumShadowMemoryAccessSkipped.fetch_add(1, std::memory_order_relaxed);
+}
+
+void PerformanceCounters::bumpNumRepeatedAccessesFiltered() {
+  mNumRepeatedAccessesFiltered.fetch_add(1, std::memory_order_relaxed);
+}
+
+void PerformanceCounters::bumpNumAccessesSampled() {
+  mNumAccessesSampled.fetch_add(1, std::memory_order_relaxed);
+}
+
+void PerformanceCounters::bumpNumAccessesNotSampled() {
+  mNumAccessesNotSampled.fetch_add(1, std::memory_order_relaxed);
+}
+
+void PerformanceCounters::recordLockWaitTime(LockWaitType type, uint64_t nanoseconds) {
+  int bucket = 63 - __builtin_clzll(nanoseconds | 1);
+  if (bucket >= LOCK_WAIT_HISTOGRAM_BUCKETS) {
+    bucket = LOCK_WAIT_HISTOGRAM_BUCKETS - 1;
+  }
+  mLockWaitHistogram[type][bucket].fetch_add(1, std::memory_order_relaxed);
+}
+
+void PerformanceCounters::bumpNumLockParks() {
+  mNumLockParks.fetch_add(1, std::memory_order_relaxed);
+}
+
+const char* lockWaitTypeToString(int type) {
+  switch(type) {
+    case eMutexWait:
+      return "mutex";
+    case eReadWait:
+      return "read";
+    case eWriteWait:
+      return "write";
+    default:
+      return "undefined";
+  }
+}
+
 void PerformanceCounters::printPerformanceCounters() const {
   LOG(INFO) << "# Check Access Function Call: " << mNumCheckAccessFunctionCall.load();      
   LOG(INFO) << "# Access History Record Overflow (threshold=" << mAccessHistoryRecordThreshold << "):  " << mNumAccessHistoryOverflow.load();
@@ -71,6 +132,24 @@ void PerformanceCounters::printPerformanceCounters() const {
   LOG(INFO) << "# Access History Remove Records: " << mNumAccessHistoryRemoveRecords.load();
   LOG(INFO) << "# Maximum Access Records Number: " << mMaximumAccessRecordsNum.load();
   LOG(INFO) << "# Skip Add Current Record: " << mNumSkipAddingCurrentRecord.load();
+  LOG(INFO) << "# Compact Record Labels: " << mNumCompactRecordLabels.load();
+  LOG(INFO) << "# Task Dependence Nodes Collected: " << mNumTaskDependenceNodesCollected.load();
+  LOG(INFO) << "# Check Data Race Retries: " << mNumCheckDataRaceRetries.load();
+  LOG(INFO) << "# Access Record Analyses Reused: " << mNumAccessRecordAnalysesReused.load();
+  LOG(INFO) << "# Runtime Context Refreshes: " << mNumRuntimeContextRefreshes.load();
+  LOG(INFO) << "# Shadow Memory Access Skipped: " << mNumShadowMemoryAccessSkipped.load();
+  LOG(INFO) << "# Repeated Accesses Filtered: " << mNumRepeatedAccessesFiltered.load();
+  LOG(INFO) << "# Accesses Sampled: " << mNumAccessesSampled.load();
+  LOG(INFO) << "# Accesses Not Sampled: " << mNumAccessesNotSampled.load();
+  LOG(INFO) << "# Lock Parks: " << mNumLockParks.load();
+  for (int type = 0; type < eNumLockWaitTypes; ++type) {
+    for (int bucket = 0; bucket < LOCK_WAIT_HISTOGRAM_BUCKETS; ++bucket) {
+      auto count = mLockWaitHistogram[type][bucket].load();
+      if (count > 0) {
+        LOG(INFO) << "# Lock Wait (" << lockWaitTypeToString(type) << ") [2^" << bucket << ", 2^" << bucket + 1 << ") ns: " << count;
+      }
+    }
+  }
   if (mNumCheckAccessFunctionCall.load() > 0) {
     LOG(INFO) << "# Average number access records traversed: " << (double) mNumTotalAccessRecordsTraversed.load() / (double) mNumCheckAccessFunctionCall.load();
   }
@@ -0,0 +1,127 @@
+#include "PoolAllocator.h"
+
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+#include <glog/logging.h>
+#include <glog/raw_logging.h>
+
+typedef struct FreeBlock {
+  FreeBlock* next;
+} FreeBlock;
+
+typedef struct PoolOwner {
+  FreeBlock* freeLists[POOL_NUM_SIZE_CLASSES];
+  std::atomic<FreeBlock*> returnLists[POOL_NUM_SIZE_CLASSES]; // released by other threads
+  char* chunkCursors[POOL_NUM_SIZE_CLASSES]; // next block to carve, nullptr if none
+  char* chunkEnds[POOL_NUM_SIZE_CLASSES];
+} PoolOwner;
+
+typedef struct ChunkHeader {
+  PoolOwner* owner;
+} ChunkHeader;
+
+// Other threads may return blocks after the owner exits, so owners are never
+// freed. Worker threads live as long as the program. The thread local 
+// pointer keeps the thread local storage trivially destructible and safe to
+// touch from late destructors.
+static thread_local PoolOwner* tPoolOwner = nullptr;
+
+inline PoolOwner* getPoolOwner() {
+  if (tPoolOwner == nullptr) {
+    tPoolOwner = new PoolOwner();
+    for (int i = 0; i < POOL_NUM_SIZE_CLASSES; ++i) {
+      tPoolOwner->freeLists[i] = nullptr;
+      tPoolOwner->returnLists[i].store(nullptr, std::memory_order_relaxed);
+      tPoolOwner->chunkCursors[i] = nullptr;
+      tPoolOwner->chunkEnds[i] = nullptr;
+    }
+  }
+  return tPoolOwner;
+}
+
+inline ChunkHeader* getChunkHeader(void* block) {
+  return reinterpret_cast<ChunkHeader*>(reinterpret_cast<uintptr_t>(block) & ~static_cast<uintptr_t>(POOL_CHUNK_SIZE - 1));
+}
+
+/*
+ * Return the index of the smallest size class that fits `size` bytes, or -1
+ * if `size` is larger than the largest size class.
+ */
+inline int getSizeClass(size_t size) {
+  auto sizeClass = 0;
+  auto blockSize = static_cast<size_t>(1) << POOL_MIN_BLOCK_SHIFT;
+  while (blockSize < size) {
+    blockSize <<= 1;
+    sizeClass++;
+  }
+  return sizeClass < POOL_NUM_SIZE_CLASSES ? sizeClass : -1;
+}
+
+/*
+ * Carve a block out of the owner's chunk of the size class, allocate a new
+ * chunk if it is used up. Blocks are aligned to their size, the first block
+ * of a chunk is left to the chunk header.
+ */
+inline void* carveBlock(PoolOwner* owner, int sizeClass) {
+  auto blockSize = static_cast<size_t>(1) << (sizeClass + POOL_MIN_BLOCK_SHIFT);
+  if (owner->chunkCursors[sizeClass] == owner->chunkEnds[sizeClass]) {
+    auto chunk = static_cast<char*>(aligned_alloc(POOL_CHUNK_SIZE, POOL_CHUNK_SIZE));
+    if (chunk == nullptr) {
+      RAW_LOG(FATAL, "%s\n", "cannot allocate memory from pool");
+    }
+    reinterpret_cast<ChunkHeader*>(chunk)->owner = owner;
+    auto headerSize = (sizeof(ChunkHeader) + blockSize - 1) / blockSize * blockSize;
+    owner->chunkCursors[sizeClass] = chunk + headerSize;
+    owner->chunkEnds[sizeClass] = chunk + POOL_CHUNK_SIZE;
+  }
+  auto block = owner->chunkCursors[sizeClass];
+  owner->chunkCursors[sizeClass] += blockSize;
+  return static_cast<void*>(block);
+}
+
+void* poolAllocate(size_t size) {
+  auto sizeClass = getSizeClass(size);
+  if (sizeClass < 0) {
+    auto result = malloc(size);
+    if (result == nullptr) {
+      RAW_LOG(FATAL, "%s\n", "cannot allocate memory from pool");
+    }
+    return result;
+  }
+  auto owner = getPoolOwner();
+  auto& freeList = owner->freeLists[sizeClass];
+  if (freeList == nullptr && owner->returnLists[sizeClass].load(std::memory_order_relaxed) != nullptr) {
+    // only the owner takes the return list, so there is no ABA problem
+    freeList = owner->returnLists[sizeClass].exchange(nullptr, std::memory_order_acquire);
+  }
+  if (freeList != nullptr) {
+    auto block = freeList;
+    freeList = block->next;
+    return static_cast<void*>(block);
+  }
+  return carveBlock(owner, sizeClass);
+}
+
+void poolDeallocate(void* ptr, size_t size) {
+  if (ptr == nullptr) {
+    return;
+  }
+  auto sizeClass = getSizeClass(size);
+  if (sizeClass < 0) {
+    free(ptr);
+    return;
+  }
+  auto block = static_cast<FreeBlock*>(ptr);
+  auto owner = getChunkHeader(ptr)->owner;
+  if (owner == tPoolOwner) {
+    block->next = owner->freeLists[sizeClass];
+    owner->freeLists[sizeClass] = block;
+    return;
+  }
+  auto& returnList = owner->returnLists[sizeClass];
+  auto head = returnList.load(std::memory_order_relaxed);
+  do {
+    block->next = head;
+  } while (!returnList.compare_exchange_weak(head, block, std::memory_order_release, std::memory_order_relaxed));
+}
@@ -3,6 +3,8 @@
 #include <glog/logging.h>
 #include <glog/raw_logging.h>
 
+#include "DataSharing.h"
+
 
 // mState bit allocation
 // bit 0: access type (write/read)
@@ -10,6 +12,7 @@
 // bit 2: is in reduction
 // bit 3: is TLS access
 // bit 4-6: data shairng type (3 bits)
+// bit 7: holds a reference of the task, set when stored in access history
 /*
  * If current access is write, set the lowest bit to 1. Otherwise, set to 0.
  * mState variable is 8-bit wide.
@@ -38,12 +41,20 @@ void Record::setIsTLSAccess(bool isTLSAccess) {
   } 
 }
 
+void Record::setHoldsTaskReference(bool holdsTaskReference) {
+  if (holdsTaskReference) {
+    mState |= 0x80;
+  } else {
+    mState &= 0x7f;
+  }
+}
+
 void Record::setDataSharingType(int dataSharingType) {
   mState |= (dataSharingType << 4);
 }
 
 int Record::getDataSharingType() const {
-  return (int) (mState >> 4);
+  return (int) ((mState >> 4) & 0x7);
 }
 
 void* Record::getMemoryAddressOwner() const {
@@ -79,6 +90,39 @@ bool Record::isTLSAccess() const {
   return (mState & 0x8) == 0x8;
 }
 
+bool Record::holdsTaskReference() const {
+  return (mState & 0x80) == 0x80;
+}
+
+/*
+ * Return false if the two accesses never race, judging from their access 
+ * flags only: both are reads, both hold a hardware lock, both are TLS 
+ * accesses or both are task private.
+ */
+bool Record::mayRaceWith(const Record& other) const {
+  auto state = mState & other.mState;
+  if ((mState & 0x1) == 0 && (other.mState & 0x1) == 0) {
+    return false;
+  }
+  if ((state & 0x2) || (state & 0x8)) {
+    return false;
+  }
+  auto isTaskPrivate = [](int dataSharingType) {
+    return dataSharingType == eThreadPrivateAccessCurrentTask || dataSharingType == eExplicitTaskPrivate;
+  };
+  return !(isTaskPrivate(getDataSharingType()) && isTaskPrivate(other.getDataSharingType()));
+}
+
+/*
+ * Return true if the race analysis of the two records against any access
+ * gives the same result. The instruction address is only used for reports. 
+ */
+bool Record::hasSameAccessContext(const Record& other) const {
+  return (mState & 0x7f) == (other.mState & 0x7f) && mLabel == other.mLabel && 
+         mLockSet == other.mLockSet && mTaskPtr == other.mTaskPtr && 
+         mOwner == other.mOwner && mEpoch == other.mEpoch;
+}
+
 /*
  * toString() is mainly for debugging
  */
@@ -94,6 +138,20 @@ Label* Record::getLabel() const {
   return mLabel? mLabel.get() : nullptr;
 }
 
+/*
+ * Replace the label with the joined label of the outermost ended parallel
+ * region the label was created in, if any.
+ */
+void Record::compactLabel() {
+  if (mLabel) {
+    mLabel = getCompactLabel(mLabel);
+  }
+}
+
+Epoch Record::getEpoch() const {
+  return mEpoch;
+}
+
 LockSet* Record::getLockSet() const {
   return mLockSet? mLockSet.get() : nullptr;
 }
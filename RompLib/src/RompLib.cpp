@@ -4,6 +4,7 @@
 #include <limits.h>
 #include <unistd.h>
 
+#include "AccessBatch.h"
 #include "AccessControl.h"
 #include "AccessHistory.h"
 #include "Core.h"
@@ -14,6 +15,7 @@
 #include "LockSet.h"
 #include "ParallelRegionData.h"
 #include "ShadowMemory.h"
+#include "SiteSampler.h"
 #include "TaskData.h"
 #include "ThreadData.h"
 
@@ -25,64 +27,193 @@ using LockSetPtr = std::shared_ptr<LockSet>;
 ShadowMemory<AccessHistory> shadowMemory;
 extern PerformanceCounters gPerformanceCounters;
 
+/*
+ * A data race has already been found on this memory location, romp only 
+ * reports one data race on any memory location in one run. Once the data 
+ * race is reported, romp clears the access history with respect to this
+ * memory location and mark this memory location as found. Future access 
+ * to this memory location does not go through data race checking.
+ */
+inline bool clearRacyAccessHistory(AccessHistory* accessHistory, ReaderWriterLockGuard& guard) {
+  if (!accessHistory->hasRecords()) {
+    return true;
+  }
+  guard.upgradeFromReaderToWriter();
+  if (accessHistory->hasRecords()) {
+    accessHistory->clearRecords(); 
+  }
+  return true;
+}
+
+/*
+ * Records are checked under the reader lock. Updating them needs the writer
+ * lock, and the records could change while upgrading. The version of the 
+ * access history tells if they did, then the records are checked again with
+ * the writer lock held, so every access is checked at most twice.
+ */
 bool checkDataRace(AccessHistory* accessHistory, const LabelPtr& curLabel, const LockSetPtr& curLockSet, void* instnAddr, 
                    void* currentTaskData, int taskFlags, bool isWrite, bool hasHardwareLock, uint64_t checkedAddress, 
-                   DataSharingType dataSharingType, bool isTLSAccess) {
+                   DataSharingType dataSharingType, bool isTLSAccess, ParallelRegionData* parallelRegionData) {
 #ifdef PERFORMANCE
   gPerformanceCounters.bumpNumCheckAccessFunctionCall();
 #endif
   pfq_rwlock_node_t me;
-  ReaderWriterLockGuard guard(&(accessHistory->getLock()), &me, &gPerformanceCounters);
+  ReaderWriterLockGuard guard(&(accessHistory->getLock()), &me, &gPerformanceCounters, accessHistory->getLockContentionCounter());
 #ifdef PERFORMANCE
   auto numRecords = accessHistory->getNumRecords();
   gPerformanceCounters.bumpNumAccessHistoryOverflow(numRecords);
   gPerformanceCounters.updateMaximumAccessRecordsNum(numRecords); 
 #endif
-rollback: // will refactor to remove the tag. Using goto tag is actually more readable for this case.
   if (accessHistory->dataRaceFound()) {
-    //  data race has already been found on this memory location, romp only 
-    //  reports one data race on any memory location in one run. Once the data 
-    //  race is reported, romp clears the access history with respect to this
-    //  memory location and mark this memory location as found. Future access 
-    //  to this memory location does not go through data race checking.
-    if (!accessHistory->hasRecords()) {
-      return true;
-    }
-    guard.upgradeFromReaderToWriter();
-    if (accessHistory->hasRecords()) {
-      accessHistory->clearRecords(); 
-    }
-    return true;
+    return clearRacyAccessHistory(accessHistory, guard);
   }
   auto taskDataPtr = static_cast<TaskData*>(currentTaskData);
   auto isInReduction = taskDataPtr->getIsInReduction();
   //auto workShareRegionId = taskDataPtr->workShareRegionId;
   auto owner = accessHistory->getOwner();
   RAW_DLOG(INFO, "set record checkedAddress: %lx owner: %lx", checkedAddress, owner);
-  auto curRecord = Record(isWrite, curLabel, curLockSet, currentTaskData, checkedAddress, hasHardwareLock,  isInReduction, (int)dataSharingType, instnAddr, isTLSAccess, owner);
+  auto curRecord = Record(isWrite, curLabel, taskDataPtr->epoch, curLockSet, currentTaskData, checkedAddress, hasHardwareLock,  isInReduction, (int)dataSharingType, instnAddr, isTLSAccess, owner);
   if (!accessHistory->hasRecords()) {
     // no access record, add current access to the record
-    auto hasWriteWriteContention = guard.upgradeFromReaderToWriter();
-    if (!hasWriteWriteContention || hasWriteWriteContention && !accessHistory->hasRecords()) {
+    guard.upgradeFromReaderToWriter();
+    if (accessHistory->dataRaceFound()) {
+      return clearRacyAccessHistory(accessHistory, guard);
+    }
+    if (!accessHistory->hasRecords()) {
       //RAW_DLOG(INFO, "add record to access history memory address: %lx in reduction %d is write: %d", curRecord.getCheckedMemoryAddress(), curRecord.isInReduction(), curRecord.isWrite());
       accessHistory->addRecordToAccessHistory(curRecord);
       return false;
-    } else {
-      goto rollback; 
     }
+    // records were added while upgrading, check them with the writer lock held
+#ifdef PERFORMANCE
+    gPerformanceCounters.bumpNumCheckDataRaceRetries();
+#endif
   }
   // check previous access records with current access, if there exists data race 
   std::vector<RecordManagementInfo> info;
-  while (true) { // coordinate data race checking and rolling back of access histroy managemnt
+  while (true) { 
+    auto version = accessHistory->getVersion();
     info.clear();
-    if (checkDataRaceForMemoryAddress(checkedAddress, accessHistory, curRecord, info)) {
+    if (checkDataRaceForMemoryAddress(checkedAddress, accessHistory, curRecord, parallelRegionData, info)) {
       gDataRaceFound = true;
       return true;
     }
-    if (manageAccessRecords(accessHistory, curRecord, guard, info)) {
-      continue;
+    if (!manageAccessRecords(accessHistory, curRecord, guard, version, info)) {
+      break;
     } 
-    break;
+    // the records changed while upgrading, the writer lock is held from now on
+#ifdef PERFORMANCE
+    gPerformanceCounters.bumpNumCheckDataRaceRetries();
+#endif
+    if (accessHistory->dataRaceFound()) {
+      return clearRacyAccessHistory(accessHistory, guard);
+    }
+  }
+  return false;
+}
+
+static thread_local LoopAccess tLoopAccesses[LOOP_ACCESS_SLOTS];
+
+/*
+ * The last access checked by checkAccess on the thread. A repeated access 
+ * in the same access epoch that touches no more bytes, and is not a write
+ * unless the last access was, would be checked against the same state of 
+ * the task and find nothing new, so it is filtered before the runtime 
+ * context is looked up.
+ */
+typedef struct LastAccess {
+  void* baseAddress;
+  uint64_t epoch;
+  uint32_t bytesAccessed;
+  bool hasHardwareLock;
+  bool isWrite;
+  bool isTLSAccess;
+} LastAccess;
+
+static thread_local LastAccess tLastAccess = {nullptr, 0, 0, false, false, false};
+
+inline bool isRepeatedAccess(void* baseAddress, uint32_t bytesAccessed, bool hasHardwareLock, bool isWrite, bool isTLSAccess) {
+  return tLastAccess.baseAddress == baseAddress && tLastAccess.epoch == tAccessEpoch &&
+         bytesAccessed <= tLastAccess.bytesAccessed && (!isWrite || tLastAccess.isWrite) &&
+         hasHardwareLock == tLastAccess.hasHardwareLock && isTLSAccess == tLastAccess.isTLSAccess;
+}
+
+/*
+ * Return true if this execution of the instruction should be checked, which
+ * is always the case unless sampling is enabled.
+ */
+inline bool isSampledAccess(void* instnAddr) {
+  if (!gSamplingEnabled) {
+    return true;
+  }
+  auto isSampled = gSiteSampler.shouldSample(instnAddr);
+#ifdef PERFORMANCE
+  if (isSampled) {
+    gPerformanceCounters.bumpNumAccessesSampled();
+  } else {
+    gPerformanceCounters.bumpNumAccessesNotSampled();
+  }
+#endif
+  return isSampled;
+}
+
+/*
+ * Return the data of the task in the runtime context, or nullptr if its 
+ * accesses are not checked.
+ */
+inline TaskData* getCurrentTaskData(const RuntimeContext* runtimeContext) {
+  const auto& taskInfo = runtimeContext->taskInfo;
+  if (taskInfo.flags == ompt_task_initial) { 
+    // don't check data race for initial task
+    return nullptr;
+  }
+  if (!taskInfo.taskData->ptr) {
+    RAW_LOG(WARNING, "pointer to current task data is null");
+    return nullptr;
+  }
+  auto currentTaskData = static_cast<TaskData*>(taskInfo.taskData->ptr);
+  currentTaskData->exitFrame = taskInfo.taskFrame->exit_frame.ptr;
+  return currentTaskData;
+}
+
+/*
+ * Check the memory accessed by one instruction of the task in the runtime 
+ * context. Return true if checking should stop because a data race is found.
+ */
+inline bool checkAccessInContext(const RuntimeContext* runtimeContext, TaskData* currentTaskData, void* baseAddress, uint32_t bytesAccessed, 
+                                 void* instnAddr, bool hasHardwareLock, bool isWrite, bool isTLSAccess) {
+  const auto& taskInfo = runtimeContext->taskInfo;
+  const auto& threadInfo = runtimeContext->threadInfo;
+  const auto& taskAddressBounds = runtimeContext->taskAddressBounds;
+  // passed down to the happens-before analysis instead of being queried per record
+  auto parallelRegionData = static_cast<ParallelRegionData*>(runtimeContext->parallelRegionInfo.parallelData->ptr);
+  auto& curLabel = currentTaskData->label;
+  auto& curLockSet = currentTaskData->lockSet;
+  auto memUnitAccessed = gUseWordLevelCheck ? (1 + ((bytesAccessed - 1) / 4)) : bytesAccessed; // implementation of ceil(bytesAccessed / 4)
+  for (uint64_t i = 0; i < memUnitAccessed; ++i) {
+    auto checkedAddress = gUseWordLevelCheck ? reinterpret_cast<uint64_t>(baseAddress) + i * 4 : reinterpret_cast<uint64_t>(baseAddress) + i;      
+    DataSharingType dataSharingType = eUnknown;
+    auto shouldCheckAccess = shouldCheckMemoryAccess(threadInfo, taskAddressBounds, taskInfo, checkedAddress, dataSharingType, isWrite, instnAddr);
+    if (!shouldCheckAccess) {
+      // Either the access is not checked at all, or the task has accessed 
+      // the address before in the same phase. The memory owner of a task 
+      // private address has been set then, and no other task could take over
+      // the address while the task's frame or private memory is alive.
+#ifdef PERFORMANCE
+      gPerformanceCounters.bumpNumShadowMemoryAccessSkipped();
+#endif
+      continue;
+    }
+    auto accessHistory = shadowMemory.getShadowMemorySlot(checkedAddress);
+    setMemoryOwner(accessHistory, dataSharingType, static_cast<void*>(currentTaskData), reinterpret_cast<void*>(checkedAddress));
+    if (checkDataRace(accessHistory, curLabel, curLockSet, instnAddr, static_cast<void*>(currentTaskData), taskInfo.flags, isWrite, hasHardwareLock, checkedAddress, dataSharingType, isTLSAccess, parallelRegionData)) {
+      if (gSamplingEnabled) {
+        gSiteSampler.onDataRace(instnAddr);
+      }
+      if (!gContinueAfterDataRace) {
+        return true;
+      }
+    }
   }
   return false;
 }
@@ -102,46 +233,128 @@ void checkAccess(void* baseAddress, uint32_t bytesAccessed, void* instnAddr, boo
 #ifdef PERFORMANCE
   gPerformanceCounters.bumpNumMemoryAccessInstrumentationCall();
 #endif
-  if (gDataRaceFound) {
+  if ((gDataRaceFound && !gContinueAfterDataRace) || !tDetectionActive) {
     return;
   }
   if (!gOmptInitialized || bytesAccessed == 0) {
     return;
   }
-  TaskInfo taskInfo;
-  ParallelRegionInfo parallelRegionInfo;
-  ThreadInfo threadInfo;
-  if (!queryRuntimeInfo(threadInfo, parallelRegionInfo, taskInfo)) {
-    RAW_LOG(FATAL, "failed to fetch openmp runtime information");
+  if (isRepeatedAccess(baseAddress, bytesAccessed, hasHardwareLock, isWrite, isTLSAccess)) {
+#ifdef PERFORMANCE
+    gPerformanceCounters.bumpNumRepeatedAccessesFiltered();
+#endif
+    return;
   }
-  if (taskInfo.flags == ompt_task_initial) { 
-    // don't check data race for initial task
+  if (!isSampledAccess(instnAddr)) {
     return;
   }
-  if (!taskInfo.taskData->ptr) {
-    RAW_LOG(WARNING, "pointer to current task data is null");
+  auto runtimeContext = queryRuntimeContext();
+  if (!runtimeContext) {
+    RAW_LOG(FATAL, "failed to fetch openmp runtime information");
+    return;
+  }
+  auto currentTaskData = getCurrentTaskData(runtimeContext);
+  if (!currentTaskData) {
     return;
   }
+  checkAccessInContext(runtimeContext, currentTaskData, baseAddress, bytesAccessed, instnAddr, hasHardwareLock, isWrite, isTLSAccess);
+  tLastAccess = LastAccess{baseAddress, tAccessEpoch, bytesAccessed, hasHardwareLock, isWrite, isTLSAccess};
+}
 
-  auto currentTaskData = static_cast<TaskData*>(taskInfo.taskData->ptr);
-  currentTaskData->exitFrame = taskInfo.taskFrame->exit_frame.ptr;
+void checkAccessBatch(const AccessDesc* accesses, uint64_t numAccesses) {
+#ifdef PERFORMANCE
+  for (uint64_t i = 0; i < numAccesses; ++i) {
+    gPerformanceCounters.bumpNumMemoryAccessInstrumentationCall();
+  }
+#endif
+  if ((gDataRaceFound && !gContinueAfterDataRace) || !tDetectionActive) {
+    return;
+  }
+  if (!gOmptInitialized || numAccesses == 0) {
+    return;
+  }
+  auto runtimeContext = queryRuntimeContext();
+  if (!runtimeContext) {
+    RAW_LOG(FATAL, "failed to fetch openmp runtime information");
+    return;
+  }
+  auto currentTaskData = getCurrentTaskData(runtimeContext);
+  if (!currentTaskData) {
+    return;
+  }
+  for (uint64_t i = 0; i < numAccesses; ++i) {
+    const auto& access = accesses[i];
+    if (access.bytesAccessed == 0 || !isSampledAccess(access.instnAddr)) {
+      continue;
+    }
+    if (checkAccessInContext(runtimeContext, currentTaskData, access.baseAddress, access.bytesAccessed, access.instnAddr, 
+                             (access.flags & eAccessHasHardwareLock) != 0, (access.flags & eAccessIsWrite) != 0, 
+                             (access.flags & eAccessIsTLS) != 0)) {
+      return;
+    }
+  }
+}
 
-  auto& curLabel = currentTaskData->label;
-  auto& curLockSet = currentTaskData->lockSet;
-  auto memUnitAccessed = gUseWordLevelCheck ? (1 + ((bytesAccessed - 1) / 4)) : bytesAccessed; // implementation of ceil(bytesAccessed / 4)
-  TaskMemoryInfo taskMemoryInfo;
-  queryTaskMemoryInfo(taskMemoryInfo);
-  for (uint64_t i = 0; i < memUnitAccessed; ++i) {
-    auto checkedAddress = gUseWordLevelCheck ? reinterpret_cast<uint64_t>(baseAddress) + i * 4 : reinterpret_cast<uint64_t>(baseAddress) + i;      
-    DataSharingType dataSharingType = eUnknown;
-    auto shouldCheckAccess = shouldCheckMemoryAccess(threadInfo, taskMemoryInfo, taskInfo, checkedAddress, taskInfo.taskFrame, dataSharingType,isWrite, instnAddr);
-    auto accessHistory = shadowMemory.getShadowMemorySlot(checkedAddress);
-    setMemoryOwner(accessHistory, dataSharingType, static_cast<void*>(currentTaskData), reinterpret_cast<void*>(checkedAddress));
-    if (shouldCheckAccess) {
-      if (checkDataRace(accessHistory, curLabel, curLockSet, instnAddr, static_cast<void*>(currentTaskData), taskInfo.flags, isWrite, hasHardwareLock, checkedAddress, dataSharingType, isTLSAccess)){
-        return;
-      }
+void checkAccessRange(void* baseAddress, int64_t stride, uint64_t count, uint32_t bytesAccessed, void* instnAddr, uint32_t flags) {
+#ifdef PERFORMANCE
+  gPerformanceCounters.bumpNumMemoryAccessInstrumentationCall();
+#endif
+  if ((gDataRaceFound && !gContinueAfterDataRace) || !tDetectionActive) {
+    return;
+  }
+  if (!gOmptInitialized || bytesAccessed == 0 || count == 0) {
+    return;
+  }
+  auto runtimeContext = queryRuntimeContext();
+  if (!runtimeContext) {
+    RAW_LOG(FATAL, "failed to fetch openmp runtime information");
+    return;
+  }
+  auto currentTaskData = getCurrentTaskData(runtimeContext);
+  if (!currentTaskData) {
+    return;
+  }
+  auto hasHardwareLock = (flags & eAccessHasHardwareLock) != 0;
+  auto isWrite = (flags & eAccessIsWrite) != 0;
+  auto isTLSAccess = (flags & eAccessIsTLS) != 0;
+  auto address = reinterpret_cast<uint64_t>(baseAddress);
+  for (uint64_t i = 0; i < count; ++i, address += stride) {
+    // every element is one execution of the instruction
+    if (!isSampledAccess(instnAddr)) {
+      continue;
+    }
+    if (checkAccessInContext(runtimeContext, currentTaskData, reinterpret_cast<void*>(address), bytesAccessed, instnAddr, hasHardwareLock, isWrite, isTLSAccess)) {
+      return;
     }
   }
 }
+
+void beginLoopAccess(uint32_t slot, uint64_t entryValue, int64_t offset, int64_t stride) {
+  if (slot >= LOOP_ACCESS_SLOTS) {
+    RAW_LOG(FATAL, "loop access slot out of range: %u", slot);
+    return;
+  }
+  tLoopAccesses[slot] = LoopAccess{entryValue, offset, stride};
+}
+
+void endLoopAccess(uint32_t slot, uint64_t exitValue, uint32_t bytesAccessed, void* instnAddr, uint32_t flags) {
+  if (!tDetectionActive) {
+    return;
+  }
+  if (slot >= LOOP_ACCESS_SLOTS) {
+    RAW_LOG(FATAL, "loop access slot out of range: %u", slot);
+    return;
+  }
+  const auto& loopAccess = tLoopAccesses[slot];
+  auto distance = static_cast<int64_t>(exitValue - loopAccess.entryValue);
+  if (loopAccess.stride == 0 || distance % loopAccess.stride != 0) {
+    RAW_LOG(WARNING, "unexpected loop access range at instn addr: %p", instnAddr);
+    return;
+  }
+  auto count = distance / loopAccess.stride;
+  if (count <= 0) {
+    return;
+  }
+  checkAccessRange(reinterpret_cast<void*>(loopAccess.entryValue + loopAccess.offset), loopAccess.stride, count, bytesAccessed, instnAddr, flags);
+}
 }
@@ -1,22 +1,20 @@
 #include "Segment.h"
 
+#include <atomic>
 #include <iomanip>
 #include <glog/logging.h>
 #include <glog/raw_logging.h>
 #include <sstream>
 
+#include "PoolAllocator.h"
+
 // mask bits are set to 1 if they represent the corresponding field location
+// flag bits always live in the first word of the segment value
 #define SEGMENT_TYPE_MASK 0x0000000000000003
 #define WORK_SHARE_PLACEHOLDER_MASK 0x0000000000000004
 #define TASKWAIT_SYNC_MASK 0x0000000000000008
 #define TASKGROUP_SYNC_MASK 0x0000000000000010
 #define SINGLE_MASK 0x0000000000000060
-#define TASK_CREATE_MASK 0x00000000000fff80
-#define LOOP_COUNT_MASK 0x0000000fff000000
-#define PHASE_MASK 0x000000f000000000
-#define TASKWAIT_MASK 0x00000f0000000000
-#define SPAN_MASK 0x003ff00000000000
-#define OFFSET_MASK 0xffc0000000000000
 
 //TODO: revisit the taskgroup handling
 #define TASKGROUP_ID_MASK    0x00000000ffff0000
@@ -25,29 +23,22 @@
 #define TASKWAIT_PHASE_MASK  0x000000000000ffff
 
 #define WORK_SHARE_TYPE_MASK 0xc000000000000000
-#define OFFSET_SPAN_WIDTH 10
-
-#define OFFSET_SHIFT 54
-#define SPAN_SHIFT 44
-#define TASKWAIT_SHIFT 40
-#define PHASE_SHIFT 36
-#define LOOP_COUNT_SHIFT 24
-#define TASK_CREATE_SHIFT 7
+
 #define WORK_SHARE_PLACEHOLDER_SHIFT 2 
 #define SINGLE_EXECUTOR_SHIFT 5
 #define SINGLE_OTHER_SHIFT 6
 #define WORK_SHARE_TYPE_SHIFT 62
 
-#define LOOP_COUNT_MASK_BITS 12
-
 /*
- * Each segment contains a 64 bit value. From low to high, assign index 0-63
+ * Compact layout (default). The segment value is one 64 bit word. From low 
+ * to high, assign index 0-63
  * [54, 63]: offset 
  * [44, 53]: span 
  * [40, 43]: taskwait count
  * [36, 39]: phase count
  * [24, 35]: loop count 
- * [20, 23]: reserved
+ * [21, 23]: reserved
+ * [20]: mark if the offset has been rebased
  * [7, 19]: task create count
  * [5, 6]: bit 5 set: is single executable; bit 6 set: is single other
  * [4]: mark if current task sync by taskgroup with its parent task
@@ -55,20 +46,51 @@
  * [2]: mark work share placeholder bit 
  * [0,1]: segment type 
  *
+ * Wide layout (-DWIDE_SEGMENT). The segment value is three 64 bit words.
+ * word 0: [48, 63] phase count, [32, 47] taskwait count, [31] offset 
+ *         rebased, [7, 30] task create count, [0, 6] same flag bits as above
+ * word 1: [32, 63] span, [0, 31] loop count
+ * word 2: [0, 63] offset
+ *
+ * Setting a counter to a value that does not fit in its field is a fatal 
+ * error instead of a silent wraparound, which would corrupt the 
+ * happens-before analysis. The only exception is the offset, which is 
+ * rebased by advanceOffsetBySpan().
+ *
  * For workshare segment, we use the extra mWorkShareID to store information
  * [0,31]: work share id 
  * [62,63]: work share type: 00: iteartion 01: section, 
  */
+uint64_t BaseSegment::getField(const SegmentField& field) const {
+  return (mValue[field.word] & field.mask()) >> field.shift;
+}
+
+void BaseSegment::setField(const SegmentField& field, uint64_t value, const char* name) {
+  if (value > field.maxValue()) {
+    RAW_LOG(FATAL, "%s %lu is overflowing its %d bit field, rebuild with -DWIDE_SEGMENT", name, value, field.width);
+  }
+  mValue[field.word] &= ~field.mask();
+  mValue[field.word] |= (value << field.shift) & field.mask();
+}
+
+bool BaseSegment::hasSameValue(const BaseSegment& segment) const {
+  for (int i = 0; i < SegmentLayout::kNumWords; ++i) {
+    if (mValue[i] != segment.mValue[i]) {
+      return false;
+    }
+  }
+  return true;
+}
+
 std::string BaseSegment::toString() const {
   std::stringstream stream;
-  if (mTaskGroup == 0) {
-    stream << std::hex << std::setw(16) << std::setfill('0') << mValue;
-  } else if (mOrderSecVal == 0) {
-    stream << std::hex << std::setw(16) << std::setfill('0') << mValue << 
-     std::setfill('0') << ",tg:" << std::hex << mTaskGroup;
-  } else {
-    stream << std::hex << std::setw(16) << std::setfill('0') << mValue << 
-    std::setfill('0') << ",tg:" << mTaskGroup << ",osv:" << 
+  for (int i = SegmentLayout::kNumWords - 1; i >= 0; --i) {
+    stream << std::hex << std::setw(16) << std::setfill('0') << mValue[i];
+  }
+  if (mTaskGroup != 0 && mOrderSecVal == 0) {
+    stream << std::setfill('0') << ",tg:" << std::hex << mTaskGroup;
+  } else if (mTaskGroup != 0) {
+    stream << std::setfill('0') << ",tg:" << mTaskGroup << ",osv:" << 
     mOrderSecVal;
   }
   return "[" + stream.str() + "]";
@@ -109,9 +131,91 @@ std::string BaseSegment::toFieldsBreakdown() const {
   return "[" + stream.str() + "]";
 }
 
-BaseSegment::BaseSegment(SegmentType type, uint64_t offset, uint64_t span) {
-  RAW_CHECK(span < (1 << OFFSET_SPAN_WIDTH), "span is overflowing");
-  mValue = 0;
+/*
+ * Binary encoding of a segment, used to persist labels in logs in a compact 
+ * form. Every value is written as an unsigned LEB128 varint:
+ * mValue words, mTaskGroup, mOrderSecVal, followed by the explicit task
+ * pointer for explicit task segments, or the work share id and type for 
+ * workshare segments. The segment type is recovered from the first word.
+ */
+void encodeVarint(uint64_t value, std::vector<uint8_t>& buffer) {
+  while (value >= 0x80) {
+    buffer.push_back(static_cast<uint8_t>(value | 0x80));
+    value >>= 7;
+  }
+  buffer.push_back(static_cast<uint8_t>(value));
+}
+
+bool decodeVarint(const uint8_t*& cursor, const uint8_t* end, uint64_t& value) {
+  value = 0;
+  for (int shift = 0; shift < 64 && cursor < end; shift += 7) {
+    auto byte = *cursor++;
+    value |= static_cast<uint64_t>(byte & 0x7f) << shift;
+    if ((byte & 0x80) == 0) {
+      return true;
+    }
+  }
+  return false;
+}
+
+void BaseSegment::encode(std::vector<uint8_t>& buffer) const {
+  for (int i = 0; i < SegmentLayout::kNumWords; ++i) {
+    encodeVarint(mValue[i], buffer);
+  }
+  encodeVarint(mTaskGroup, buffer);
+  encodeVarint(mOrderSecVal, buffer);
+}
+
+/*
+ * Decode one segment starting at `cursor` and advance `cursor` past it. 
+ * Return nullptr if the buffer is truncated or malformed.
+ */
+std::shared_ptr<BaseSegment> BaseSegment::decode(const uint8_t*& cursor, const uint8_t* end) {
+  uint64_t value[SegmentLayout::kNumWords];
+  uint64_t taskGroup, orderSecVal;
+  for (int i = 0; i < SegmentLayout::kNumWords; ++i) {
+    if (!decodeVarint(cursor, end, value[i])) {
+      return nullptr;
+    }
+  }
+  if (!decodeVarint(cursor, end, taskGroup) || !decodeVarint(cursor, end, orderSecVal)) {
+    return nullptr;
+  }
+  std::shared_ptr<BaseSegment> segment = nullptr;
+  switch(value[0] & SEGMENT_TYPE_MASK) {
+    case eImplicit:
+      segment = makePoolShared<BaseSegment>();
+      break;
+    case eExplicit:
+    {
+      uint64_t taskPtr;
+      if (!decodeVarint(cursor, end, taskPtr)) {
+        return nullptr;
+      }
+      segment = makePoolShared<ExplicitTaskSegment>(reinterpret_cast<void*>(taskPtr));
+      break;
+    }
+    case eLogical:
+    {
+      uint64_t workShareId, workShareType;
+      if (!decodeVarint(cursor, end, workShareId) || !decodeVarint(cursor, end, workShareType)) {
+        return nullptr;
+      }
+      segment = makePoolShared<WorkShareSegment>(workShareId, static_cast<WorkShareType>(workShareType));
+      break;
+    }
+    default:
+      return nullptr;
+  }
+  for (int i = 0; i < SegmentLayout::kNumWords; ++i) {
+    segment->mValue[i] = value[i];
+  }
+  segment->mTaskGroup = static_cast<uint32_t>(taskGroup);
+  segment->mOrderSecVal = static_cast<uint32_t>(orderSecVal);
+  return segment;
+}
+
+BaseSegment::BaseSegment(SegmentType type, uint64_t offset, uint64_t span): mValue() {
   mTaskGroup = 0;
   mOrderSecVal = 0;
   setType(type);
@@ -119,22 +223,49 @@ BaseSegment::BaseSegment(SegmentType type, uint64_t offset, uint64_t span) {
 }
 
 std::shared_ptr<BaseSegment> BaseSegment::clone() const {
-  return std::make_shared<BaseSegment>(*this);
-}
-
-uint64_t BaseSegment::getValue() const {
-  return mValue;
+  return makePoolShared<BaseSegment>(*this);
 }
 
 void BaseSegment::setOffsetSpan(uint64_t offset, uint64_t span) {
-  mValue &= ~(OFFSET_MASK | SPAN_MASK);  // clear the offset, span field
-  mValue |= (offset << OFFSET_SHIFT) & OFFSET_MASK; 
-  mValue |= (span << SPAN_SHIFT) & SPAN_MASK; 
+  setField(SegmentLayout::kOffset, offset, "offset");
+  setField(SegmentLayout::kSpan, span, "span");
 }
 
 void BaseSegment::getOffsetSpan(uint64_t& offset, uint64_t& span) const {
-  offset = (mValue & OFFSET_MASK) >> OFFSET_SHIFT;
-  span = (mValue & SPAN_MASK) >> SPAN_SHIFT;
+  offset = getField(SegmentLayout::kOffset);
+  span = getField(SegmentLayout::kSpan);
+}
+
+/*
+ * Move the offset to the next barrier phase of the same implicit task. If the
+ * offset field can not hold the new value, rebase it: offset % span, which 
+ * identifies the implicit task, is kept and the number of barrier phases 
+ * wraps around. The segment is marked so that the happens-before analysis 
+ * does not expect the offset to be monotonic.
+ */
+void BaseSegment::advanceOffsetBySpan() {
+  static std::atomic_flag rebaseReported = ATOMIC_FLAG_INIT;
+  uint64_t offset, span;
+  getOffsetSpan(offset, span);
+  auto maxOffset = SegmentLayout::kOffset.maxValue();
+  if (offset <= maxOffset - span) {
+    setField(SegmentLayout::kOffset, offset + span, "offset");
+    return;
+  }
+  auto numPhases = maxOffset / span + (maxOffset % span == span - 1 ? 1 : 0);
+  if (numPhases < 2) {
+    RAW_LOG(FATAL, "span %lu leaves no room to rebase offset, rebuild with -DWIDE_SEGMENT", span);
+  }
+  if (!rebaseReported.test_and_set()) {
+    RAW_LOG(WARNING, "offset field is overflowing, rebasing. Consider rebuilding with -DWIDE_SEGMENT");
+  }
+  auto nextPhase = (offset / span + 1) % numPhases;
+  setField(SegmentLayout::kOffset, offset % span + nextPhase * span, "offset");
+  setField(SegmentLayout::kOffsetRebased, 1, "offset rebased flag");
+}
+
+bool BaseSegment::isOffsetRebased() const {
+  return getField(SegmentLayout::kOffsetRebased) != 0;
 }
 
 /* 
@@ -192,35 +323,35 @@ uint16_t BaseSegment::getTaskGroupPhase() const {
 }
 
 void BaseSegment::setTaskwaited() {
-  mValue |= TASKWAIT_SYNC_MASK; 
+  mValue[0] |= TASKWAIT_SYNC_MASK; 
 }
 
 bool BaseSegment::isTaskwaited() const {
-  return (mValue & TASKWAIT_SYNC_MASK) != 0;
+  return (mValue[0] & TASKWAIT_SYNC_MASK) != 0;
 }
 
 bool BaseSegment::isSingleExecutor() const {
-  return (mValue & SINGLE_MASK) >>  SINGLE_EXECUTOR_SHIFT;
+  return (mValue[0] & SINGLE_MASK) >>  SINGLE_EXECUTOR_SHIFT;
 }
 
 bool BaseSegment::isSingleOther() const {
-  return (mValue & SINGLE_MASK) >> SINGLE_OTHER_SHIFT;
+  return (mValue[0] & SINGLE_MASK) >> SINGLE_OTHER_SHIFT;
 }
 
 void BaseSegment::toggleSingleExecutor() {
-  mValue ^= 1UL << SINGLE_EXECUTOR_SHIFT;   
+  mValue[0] ^= 1UL << SINGLE_EXECUTOR_SHIFT;   
 }
 
 void BaseSegment::toggleSingleOther() {
-  mValue ^= 1UL << SINGLE_OTHER_SHIFT;
+  mValue[0] ^= 1UL << SINGLE_OTHER_SHIFT;
 }
 
 void BaseSegment::setTaskGroupSync() { 
-  mValue |= TASKGROUP_SYNC_MASK;
+  mValue[0] |= TASKGROUP_SYNC_MASK;
 }
 
 bool BaseSegment::isTaskGroupSync() const {
-  return (mValue & TASKGROUP_SYNC_MASK) != 0;
+  return (mValue[0] & TASKGROUP_SYNC_MASK) != 0;
 }
 
 void BaseSegment::setTaskGroupLevel(uint16_t taskGroupLevel) {
@@ -229,7 +360,7 @@ void BaseSegment::setTaskGroupLevel(uint16_t taskGroupLevel) {
 }
 
 bool BaseSegment::operator==(const Segment& segment) const {
-  return mValue == dynamic_cast<const BaseSegment&>(segment).mValue;
+  return hasSameValue(dynamic_cast<const BaseSegment&>(segment));
 }
 
 bool BaseSegment::operator!=(const Segment& segment) const {
@@ -237,52 +368,43 @@ bool BaseSegment::operator!=(const Segment& segment) const {
 }
 
 void BaseSegment::setTaskwait(uint64_t taskwait) {
-  RAW_CHECK(taskwait < (1 << 4), "taskwait count is overflowing");
-  mValue &= ~TASKWAIT_MASK; // clear the taskwait field 
-  mValue |= (taskwait << TASKWAIT_SHIFT) & TASKWAIT_MASK;
+  setField(SegmentLayout::kTaskwait, taskwait, "taskwait count");
 }
 
 uint64_t BaseSegment::getTaskwait() const {
-  uint64_t taskwait = (mValue & TASKWAIT_MASK) >> TASKWAIT_SHIFT;
-  return taskwait;
+  return getField(SegmentLayout::kTaskwait);
 }
 
 void BaseSegment::setTaskCreateCount(uint64_t taskcreate) { 
-  RAW_CHECK(taskcreate < (1 << 13), "taskcreate count is overflowing");
-  mValue &= ~TASK_CREATE_MASK;
-  mValue |= (taskcreate << TASK_CREATE_SHIFT) & TASK_CREATE_MASK;
+  setField(SegmentLayout::kTaskCreate, taskcreate, "taskcreate count");
 }
 
 uint64_t BaseSegment::getTaskcreate() const {
-  return static_cast<uint64_t>((mValue & TASK_CREATE_MASK) >> TASK_CREATE_SHIFT);
+  return getField(SegmentLayout::kTaskCreate);
 }
 
 void BaseSegment::setPhase(uint64_t phase) {
-  RAW_CHECK(phase < 16, "phase count is overflowing");
-  mValue &= ~PHASE_MASK;
-  mValue |= (phase << PHASE_SHIFT) & PHASE_MASK;
+  setField(SegmentLayout::kPhase, phase, "phase count");
 }
 
 uint64_t BaseSegment::getPhase() const {
-  return static_cast<uint64_t>((mValue & PHASE_MASK) >> PHASE_SHIFT);
+  return getField(SegmentLayout::kPhase);
 }
 
 void BaseSegment::setLoopCount(uint64_t loopCount) {
-  RAW_CHECK(loopCount < (1 << LOOP_COUNT_MASK_BITS), "loop count is overflowing");
-  mValue &= ~LOOP_COUNT_MASK;
-  mValue |= (loopCount << LOOP_COUNT_SHIFT) & LOOP_COUNT_MASK;
+  setField(SegmentLayout::kLoopCount, loopCount, "loop count");
 }
 
 uint64_t BaseSegment::getLoopCount() const {
-  return static_cast<uint64_t>((mValue & LOOP_COUNT_MASK) >> LOOP_COUNT_SHIFT);
+  return getField(SegmentLayout::kLoopCount);
 }
 
 void BaseSegment::setType(SegmentType type) {
-  mValue |= static_cast<uint64_t>(type);
+  mValue[0] |= static_cast<uint64_t>(type);
 }
 
 SegmentType BaseSegment::getType() const {
-  auto mask = mValue & SEGMENT_TYPE_MASK;
+  auto mask = mValue[0] & SEGMENT_TYPE_MASK;
   switch(mask) {
     case 0x1:
       return eImplicit;
@@ -291,7 +413,7 @@ SegmentType BaseSegment::getType() const {
     case 0x3:
       return eLogical; 
   }
-  RAW_LOG(FATAL, "undefined segment type: %d", mask);
+  RAW_LOG(FATAL, "undefined segment type: %lu", mask);
   return eError;
 }
 
@@ -315,20 +437,26 @@ std::string WorkShareSegment::toFieldsBreakdown() const {
   return result;
 }
 
+void WorkShareSegment::encode(std::vector<uint8_t>& buffer) const {
+  BaseSegment::encode(buffer);
+  encodeVarint(mWorkShareID, buffer);
+  encodeVarint(mWorkShareType, buffer);
+}
+
 std::shared_ptr<BaseSegment> WorkShareSegment::clone() const {
-  return std::make_shared<WorkShareSegment>(*this);
+  return makePoolShared<WorkShareSegment>(*this);
 }
 
 void WorkShareSegment::toggleWorkSharePlaceHolderFlag() {
-  mValue ^= 1UL << WORK_SHARE_PLACEHOLDER_SHIFT;   
+  mValue[0] ^= 1UL << WORK_SHARE_PLACEHOLDER_SHIFT;   
 }
 
 bool WorkShareSegment::isWorkSharePlaceHolder() const {
-  return (mValue & WORK_SHARE_PLACEHOLDER_MASK) >>  WORK_SHARE_PLACEHOLDER_SHIFT;
+  return (mValue[0] & WORK_SHARE_PLACEHOLDER_MASK) >>  WORK_SHARE_PLACEHOLDER_SHIFT;
 }
 
 bool WorkShareSegment::operator==(const Segment& segment) const {
-  if (mValue == dynamic_cast<const BaseSegment&>(segment).getValue()) {
+  if (hasSameValue(dynamic_cast<const BaseSegment&>(segment))) {
     // we know `segment` is also a workshare segment
     return mWorkShareID == dynamic_cast<const WorkShareSegment&>(segment).mWorkShareID;
   } 
@@ -374,8 +502,13 @@ std::string ExplicitTaskSegment::toString() const {
   return result;
 }
 
+void ExplicitTaskSegment::encode(std::vector<uint8_t>& buffer) const {
+  BaseSegment::encode(buffer);
+  encodeVarint(reinterpret_cast<uint64_t>(mTaskDataPtr), buffer);
+}
+
 std::shared_ptr<BaseSegment> ExplicitTaskSegment::clone() const {
-  return std::make_shared<ExplicitTaskSegment>(*this);
+  return makePoolShared<ExplicitTaskSegment>(*this);
 }
   
 std::string ExplicitTaskSegment::toFieldsBreakdown() const {
@@ -387,7 +520,7 @@ std::string ExplicitTaskSegment::toFieldsBreakdown() const {
 }
 
 bool ExplicitTaskSegment::operator==(const Segment& segment) const {
-  if (mValue == dynamic_cast<const BaseSegment&>(segment).getValue()) {
+  if (hasSameValue(dynamic_cast<const BaseSegment&>(segment))) {
     // we know `segment` is also a workshare segment 
     return mTaskDataPtr == dynamic_cast<const ExplicitTaskSegment&>(segment).mTaskDataPtr;
   } 
@@ -0,0 +1,66 @@
+#include "ShadowLockTable.h"
+
+#include <glog/logging.h>
+#include <glog/raw_logging.h>
+
+#include "AccessHistory.h"
+
+void ShadowLockTable::init(uint64_t numStripes) {
+  if (numStripes == 0) {
+    numStripes = SHADOW_LOCK_TABLE_DEFAULT_STRIPES;
+  }
+  int numBits = 0;
+  while ((1ULL << numBits) < numStripes) {
+    numBits++;
+  }
+  mNumStripes = 1ULL << numBits;
+  mStripeIndexShift = 64 - numBits;
+  mStripes.reset(new ShadowLockStripe[mNumStripes]);
+  for (uint64_t i = 0; i < mNumStripes; ++i) {
+    pfq_rwlock_init(&(mStripes[i].lock));
+    mStripes[i].numContentions.store(0, std::memory_order_relaxed);
+  }
+  LOG(INFO) << "shadow memory lock stripes: " << mNumStripes;
+}
+
+/*
+ * Neighboring cells are usually accessed together, the fibonacci hash of
+ * the cell index spreads them over the stripes.
+ */
+ShadowLockStripe& ShadowLockTable::getStripe(const void* cell) {
+  auto cellIndex = reinterpret_cast<uint64_t>(cell) / sizeof(AccessHistory);
+  if (mStripeIndexShift == 64) {
+    return mStripes[0];
+  }
+  return mStripes[(cellIndex * 0x9e3779b97f4a7c15ULL) >> mStripeIndexShift];
+}
+
+pfq_rwlock_t& ShadowLockTable::getLock(const void* cell) {
+  return getStripe(cell).lock;
+}
+
+std::atomic_uint64_t* ShadowLockTable::getContentionCounter(const void* cell) {
+  return &(getStripe(cell).numContentions);
+}
+
+void ShadowLockTable::printContention() const {
+  uint64_t totalContentions = 0;
+  uint64_t maxContentions = 0;
+  uint64_t maxStripe = 0;
+  uint64_t numContendedStripes = 0;
+  for (uint64_t i = 0; i < mNumStripes; ++i) {
+    auto numContentions = mStripes[i].numContentions.load(std::memory_order_relaxed);
+    totalContentions += numContentions;
+    if (numContentions > 0) {
+      numContendedStripes++;
+    }
+    if (numContentions > maxContentions) {
+      maxContentions = numContentions;
+      maxStripe = i;
+    }
+  }
+  LOG(INFO) << "# Shadow Lock Stripes: " << mNumStripes;
+  LOG(INFO) << "# Shadow Lock Stripes Contended: " << numContendedStripes;
+  LOG(INFO) << "# Shadow Lock Contention: " << totalContentions;
+  LOG(INFO) << "# Shadow Lock Maximum Stripe Contention: " << maxContentions << " (stripe " << maxStripe << ")";
+}
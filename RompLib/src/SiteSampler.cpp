@@ -0,0 +1,60 @@
+#include "SiteSampler.h"
+
+#include <glog/logging.h>
+#include <glog/raw_logging.h>
+#include <memory>
+
+// allocated on first use, it is too large for the static tls block
+static thread_local std::unique_ptr<SiteSamplingState[]> tSiteStates;
+
+void SiteSampler::init(uint32_t burstLength, double minSampleRate) {
+  if (burstLength == 0) {
+    burstLength = SITE_SAMPLER_DEFAULT_BURST_LENGTH;
+  }
+  // also rejects nan, which fails every comparison
+  if (!(minSampleRate > 0 && minSampleRate <= 1)) {
+    minSampleRate = SITE_SAMPLER_DEFAULT_MIN_RATE;
+  }
+  mBurstLength = burstLength;
+  // the period only doubles, round the maximum down to a power of two
+  uint64_t maxSamplingPeriod = 1;
+  while (maxSamplingPeriod < SITE_SAMPLER_MAX_PERIOD && maxSamplingPeriod * 2 <= 1 / minSampleRate) {
+    maxSamplingPeriod *= 2;
+  }
+  mMaxSamplingPeriod = maxSamplingPeriod;
+  LOG(INFO) << "sampling burst length: " << mBurstLength << ", minimum rate: 1/" << mMaxSamplingPeriod;
+}
+
+SiteSamplingState& SiteSampler::getState(void* instnAddr) {
+  if (!tSiteStates) {
+    tSiteStates.reset(new SiteSamplingState[SITE_SAMPLER_SLOTS]());
+  }
+  // instructions are not aligned, the fibonacci hash spreads neighboring sites
+  auto index = (reinterpret_cast<uint64_t>(instnAddr) * 0x9e3779b97f4a7c15ULL) >> 52;
+  auto& state = tSiteStates[index % SITE_SAMPLER_SLOTS];
+  if (state.instnAddr != instnAddr) {
+    state = SiteSamplingState{instnAddr, 0, mBurstLength, 1};
+  }
+  return state;
+}
+
+bool SiteSampler::shouldSample(void* instnAddr) {
+  auto& state = getState(instnAddr);
+  if (state.numSkipsLeft > 0) {
+    state.numSkipsLeft--;
+    return false;
+  }
+  if (--state.numSamplesLeft == 0) {
+    state.numSamplesLeft = mBurstLength;
+    if (state.samplingPeriod < mMaxSamplingPeriod) {
+      state.samplingPeriod *= 2;
+    }
+  }
+  state.numSkipsLeft = state.samplingPeriod - 1;
+  return true;
+}
+
+void SiteSampler::onDataRace(void* instnAddr) {
+  auto& state = getState(instnAddr);
+  state = SiteSamplingState{instnAddr, 0, mBurstLength, 1};
+}
@@ -6,8 +6,47 @@
 TaskData::TaskData() {
   label = nullptr;
   lockSet = nullptr;
+  epoch = 0;
+  clockIndex = 0;
+  numBarriers = 0;
   exitFrame = nullptr;
   metaData = 0;
+  numReferences = 0;
+  parentTask = nullptr;
+  dependenceGraph = nullptr;
+  dependenceNode = nullptr;
+}
+
+void TaskData::acquireReference() {
+  numReferences.fetch_add(1, std::memory_order_relaxed);
+}
+
+/*
+ * Release a reference of the task. A dead task no longer keeps its explicit
+ * parent task alive, so release the parent's reference as well.
+ */
+void TaskData::releaseReference() {
+  auto taskData = this;
+  while (taskData && taskData->numReferences.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+    taskData = taskData->parentTask;
+  }
+}
+
+/*
+ * Undeferred tasks are only looked up while this task is running.
+ */
+void TaskData::releaseUndeferredTasks() {
+  for (auto undeferredTask : undeferredTasks) {
+    auto undeferredTaskData = static_cast<TaskData*>(undeferredTask);
+    if (undeferredTaskData->getIsReferenceCounted()) {
+      undeferredTaskData->releaseReference();
+    }
+  }
+  undeferredTasks.clear();
+}
+
+bool TaskData::isReferenced() const {
+  return numReferences.load(std::memory_order_acquire) > 0;
 }
 
 void TaskData::recordExplicitTaskData(TaskData* taskData) {
@@ -15,6 +54,9 @@ void TaskData::recordExplicitTaskData(TaskData* taskData) {
 }
 
 void TaskData::recordUndeferredTaskData(TaskData* taskData) {
+  if (taskData->getIsReferenceCounted()) {
+    taskData->acquireReference();
+  }
   undeferredTasks.push_back(static_cast<void*>(taskData));
 }
 
@@ -82,6 +124,22 @@ void TaskData::setIsComplete(bool isComplete) {
   }
 }
 
+void TaskData::setIsReferenceCounted(bool isReferenceCounted) {
+  if (!isReferenceCounted) {
+    metaData &= ~eIsReferenceCounted;
+  } else {
+    metaData |= eIsReferenceCounted;
+  }
+}
+
+void TaskData::setIsInitialTask(bool isInitialTask) {
+  if (!isInitialTask) {
+    metaData &= ~eIsInitialTask;
+  } else {
+    metaData |= eIsInitialTask;
+  }
+}
+
 void TaskData::setIsTaskwait(bool isTaskwait) {
   if (!isTaskwait) {
     metaData &= ~eIsTaskwait;
@@ -146,3 +204,14 @@ bool TaskData::getHasDependence() const {
   return (metaData & eHasDependence) == eHasDependence;
 }
 
+bool TaskData::getIsComplete() const {
+  return (metaData & eIsComplete) == eIsComplete;
+}
+
+bool TaskData::getIsReferenceCounted() const {
+  return (metaData & eIsReferenceCounted) == eIsReferenceCounted;
+}
+
+bool TaskData::getIsInitialTask() const {
+  return (metaData & eIsInitialTask) == eIsInitialTask;
+}
@@ -2,26 +2,70 @@
 
 #include <glog/logging.h>
 #include <glog/raw_logging.h>
+#include <algorithm>
 #include <stack>
+#include <unordered_set>
 
+#include "AccessControl.h"
+#include "PerformanceCounters.h"
 #include "TaskData.h"
+
+extern PerformanceCounters gPerformanceCounters;
+
+TaskDependenceGraph::TaskDependenceGraph() : mCollectThreshold(TASK_GRAPH_MIN_COLLECT_THRESHOLD) {
+  for (auto& shard : mShards) {
+    mcs_init(&shard.lock);
+  }
+}
+
+/*
+ * The graph is destroyed at the end of the parallel region, after all tasks
+ * in the region have completed. Queries on other graphs never dereference 
+ * the nodes published by this graph.
+ */
+TaskDependenceGraph::~TaskDependenceGraph() {
+  for (auto& entry : mNodes) {
+    static_cast<TaskData*>(entry.first)->dependenceNode.store(nullptr, std::memory_order_release);
+    delete entry.second.published;
+  }
+}
+
+inline size_t getShardIndex(void* variable) {
+  // dependence variables are at least word aligned 
+  return (reinterpret_cast<uint64_t>(variable) >> 3) % TASK_GRAPH_NUM_DEPENDENCE_SHARDS;
+}
+
+inline void appendPredecessors(void* taskPtr, const std::vector<void*>& tasks, std::vector<void*>& predecessors) {
+  for (const auto otherTaskPtr : tasks) {
+    if (otherTaskPtr == taskPtr) {
+      // the task has multiple dependences on the same variable
+      continue;
+    }
+    // keep the predecessor alive until the edge is added, it may no longer 
+    // be registered once the shard lock is released
+    auto otherTaskData = static_cast<TaskData*>(otherTaskPtr);
+    if (otherTaskData->getIsReferenceCounted()) {
+      otherTaskData->acquireReference();
+    }
+    predecessors.push_back(otherTaskPtr);
+  }
+}
+
 /*
- * Given a task referred to by taskPtr, register its dependence in mDependences
- * mDependences is a map that takes the variable address as the key. The value is 
- * a vector of (taskPtr, dependence type) pair. Each time a new dependence
- * is added to the mDependences, it looks up all pairs in the corresponding vector 
- * using the variable as a key, find tasks that are generated before current
- * task (sibling tasks) and update the task graph edge depending on
- * the dependence type: 
- *  a. 'in': for any task with dependence type 'mutexinoutset', 'out', 'inout', 
- *      add an adge from that task to current task
- *  b. 'out' and 'inout': for any task with dependence type 'in', 'out', 
- *      'inout', 'mutexinoutset', add an edge from that task to current task
- *  c.  'mutexinoutset': for any task with dependence type 'in', 'out', 
- *       'inout', add an edge from that task to current task; for any task 
- *       dependence type 'mutexinoutset', form a pair of mutual exclusion task
+ * Given a task referred to by taskPtr, register its dependence in the entry
+ * of the dependence variable and append the tasks it depends on to 
+ * `predecessors`, following the dependence types: 
+ *  a. 'in': depends on the last writers, and joins the readers
+ *  b. 'out' and 'inout': depends on the readers if there is any, otherwise
+ *      on the last writers. Becomes the only writer and clears the readers.
+ *  c. 'mutexinoutset' and 'inoutset': if the last writers is a group of the
+ *      same type without readers after it, joins the group and depends on the
+ *      group's predecessors. Otherwise starts a new group like b. Tasks of a
+ *      'mutexinoutset' group are marked as mutual exclusion tasks.
+ * Tasks depending on the readers are transitively ordered after the writers,
+ * so every task gets edges from the latest tasks only.
  */
-void TaskDependenceGraph::addDependence(void* taskPtr, const ompt_dependence_t& dependence) {
+void TaskDependenceGraph::addDependence(void* taskPtr, const ompt_dependence_t& dependence, std::vector<void*>& predecessors) {
   // dependence variable is stored in ptr field
   auto variable = dependence.variable.ptr; 
   auto dependenceType = dependence.dependence_type;
@@ -34,43 +78,59 @@ void TaskDependenceGraph::addDependence(void* taskPtr, const ompt_dependence_t&
     auto taskData = static_cast<TaskData*>(taskPtr);
     taskData->setIsMutexTask(true);
   }
-  // look up tasks that share the same dependence variable
-  if (mDependences.find(variable) == mDependences.end()) {
-    // no variable is found, it could be the first encountered task
-    RAW_DLOG(INFO, "no variable is found %lx", variable);
-    std::vector<std::pair<void*, ompt_dependence_type_t>> depVec;
-    depVec.push_back(std::make_pair(taskPtr, dependenceType));
-    mDependences[variable] = depVec;
-  } else {
-    // found the dependence variable, iterate over all pairs in the vector
-    auto curTaskData = static_cast<TaskData*>(taskPtr);
-    for (const auto& pair : mDependences[variable]) {
-      auto otherTaskData = static_cast<TaskData*>(pair.first);
-      auto otherDependenceType = pair.second;          
-      if (dependenceType == ompt_dependence_type_in) {
-        if (otherDependenceType == ompt_dependence_type_out || 
-            otherDependenceType == ompt_dependence_type_inout || 
-            otherDependenceType == ompt_dependence_type_mutexinoutset) {
-          addEdge((void*)otherTaskData, (void*)curTaskData);
-          RAW_DLOG(INFO, "add edge: other task data: %lx -> cur task data: %lx", otherTaskData, curTaskData);
-        }
-      } else if (dependenceType == ompt_dependence_type_out || dependenceType == ompt_dependence_type_inout) {
-        if (otherDependenceType == ompt_dependence_type_in ||
-            otherDependenceType == ompt_dependence_type_inout || 
-            otherDependenceType == ompt_dependence_type_mutexinoutset) {
-          addEdge((void*)otherTaskData, (void*)curTaskData);
-          RAW_DLOG(INFO, "add edge: other task data: %lx -> cur task data: %lx", otherTaskData, curTaskData);
-        }
-      } else if (dependenceType == ompt_dependence_type_mutexinoutset) {
-        if (otherDependenceType == ompt_dependence_type_in ||
-            otherDependenceType == ompt_dependence_type_inout || 
-            otherDependenceType == ompt_dependence_type_out) {
-          addEdge((void*)otherTaskData, (void*)curTaskData);
-          RAW_DLOG(INFO, "add edge: other task data: %lx -> cur task data: %lx", otherTaskData, curTaskData);
-        }
+  auto& shard = mShards[getShardIndex(variable)];
+  mcs_node_t node;
+  LockGuard guard(&(shard.lock), &node, nullptr);
+  auto& entry = shard.entries[variable];
+  switch(dependenceType) {
+    case ompt_dependence_type_in:
+      appendPredecessors(taskPtr, entry.writers, predecessors);
+      entry.readers.push_back(taskPtr);
+      break;
+    case ompt_dependence_type_out:
+    case ompt_dependence_type_inout:
+      appendPredecessors(taskPtr, entry.readers.empty() ? entry.writers : entry.readers, predecessors);
+      entry.writers.clear();
+      entry.writers.push_back(taskPtr);
+      entry.readers.clear();
+      entry.groupPredecessors.clear();
+      entry.writerType = dependenceType;
+      break;
+    case ompt_dependence_type_mutexinoutset:
+    case ompt_dependence_type_inoutset:
+      if (!entry.writers.empty() && entry.readers.empty() && entry.writerType == dependenceType) {
+        appendPredecessors(taskPtr, entry.groupPredecessors, predecessors);
+        entry.writers.push_back(taskPtr);
+      } else {
+        entry.groupPredecessors = entry.readers.empty() ? std::move(entry.writers) : std::move(entry.readers);
+        appendPredecessors(taskPtr, entry.groupPredecessors, predecessors);
+        entry.writers.clear();
+        entry.writers.push_back(taskPtr);
+        entry.readers.clear();
+        entry.writerType = dependenceType;
       }
+      break;
+    default:
+      RAW_LOG(WARNING, "unknown dependence type: %d", dependenceType);
+      break;
+  }
+}
+
+/*
+ * Add edges from the predecessors found by addDependence to the task, and
+ * release the references acquired on them. Must be called with the writer
+ * lock of the parallel region held.
+ */
+void TaskDependenceGraph::addEdges(void* taskPtr, const std::vector<void*>& predecessors) {
+  for (const auto predecessor : predecessors) {
+    addEdge(predecessor, taskPtr);
+    RAW_DLOG(INFO, "add edge: other task data: %lx -> cur task data: %lx", predecessor, taskPtr);
+    auto predecessorTaskData = static_cast<TaskData*>(predecessor);
+    if (predecessorTaskData->getIsReferenceCounted()) {
+      predecessorTaskData->releaseReference();
     }
-  } 
+  }
+  publishNodes();
 }
 
 void TaskDependenceGraph::addEdge(void* from, void* to) {
@@ -81,33 +141,269 @@ void TaskDependenceGraph::addEdge(void* from, void* to) {
   } else {
     mGraph[from].push_back(to);
   }
+  auto& fromNode = getNode(from, nullptr);
+  if (from == to) {
+    return;
+  }
+  mPredecessors[to].push_back(from);
+  auto& toNode = getNode(to, &fromNode);
+  if (mergeReachability(toNode, fromNode)) {
+    markDirty(to, toNode);
+    if (mGraph.find(to) != mGraph.end()) {
+      // dependences of a task are registered before its successors are 
+      // created, so this is not expected. Keep the index exact anyway.
+      propagateReachability(to);
+    }
+  }
+}
+
+void TaskDependenceGraph::markDirty(void* taskPtr, ReachabilityNode& node) {
+  if (!node.isDirty) {
+    node.isDirty = true;
+    mDirtyTasks.push_back(taskPtr);
+  }
 }
 
 /*
- * Use dfs to find directed path. We assume the graph is DAG.
+ * Publish a copy of every changed index entry, and free the replaced copies
+ * once no reader could refer to them.
  */
-bool TaskDependenceGraph::hasPath(void* src, void* dest) {
-  std::unordered_map<void*, bool> visited;  
-  if (mGraph.find(src) == mGraph.end()) {
-    return false;	
+void TaskDependenceGraph::publishNodes() {
+  for (const auto taskPtr : mDirtyTasks) {
+    auto it = mNodes.find(taskPtr);
+    if (it == mNodes.end()) {
+      continue;
+    }
+    auto& node = it->second;
+    auto published = new DependenceNode(static_cast<const DependenceNode&>(node));
+    auto taskData = static_cast<TaskData*>(taskPtr);
+    taskData->dependenceGraph.store(static_cast<const void*>(this), std::memory_order_relaxed);
+    taskData->dependenceNode.store(published, std::memory_order_release);
+    mRetiredNodes.retire(node.published);
+    node.published = published;
+    node.isDirty = false;
+  }
+  mDirtyTasks.clear();
+  mRetiredNodes.reclaim();
+}
+
+/*
+ * Return the index entry published by this graph for the task. Must be 
+ * called inside a read section.
+ */
+const DependenceNode* TaskDependenceGraph::loadNode(void* taskPtr) const {
+  auto taskData = static_cast<TaskData*>(taskPtr);
+  if (taskData->dependenceGraph.load(std::memory_order_acquire) != static_cast<const void*>(this)) {
+    return nullptr;
+  }
+  return taskData->dependenceNode.load(std::memory_order_acquire);
+}
+
+/*
+ * Return the reachability node of the task, create it if it does not exist.
+ * A new node extends the chain of `predecessor` if `predecessor` is the last
+ * node of its chain. Otherwise the new node starts a new chain.
+ */
+TaskDependenceGraph::ReachabilityNode& TaskDependenceGraph::getNode(void* taskPtr, ReachabilityNode* predecessor) {
+  auto it = mNodes.find(taskPtr);
+  if (it != mNodes.end()) {
+    return it->second;
+  }
+  ReachabilityNode node;
+  node.published = nullptr;
+  node.isDirty = false;
+  if (predecessor && predecessor->position == mChains[predecessor->chain].length) {
+    node.chain = predecessor->chain;
+    node.position = predecessor->position + 1;
+  } else if (!mFreeChains.empty()) {
+    // positions continue after the removed nodes, so that stale reach 
+    // entries of this chain never cover the new node
+    node.chain = mFreeChains.back();
+    node.position = mChains[node.chain].length + 1;
+    mFreeChains.pop_back();
+  } else {
+    node.chain = mChains.size();
+    node.position = 1;
+    mChains.push_back({0, 0});
   }
+  mChains[node.chain].length = node.position;
+  mChains[node.chain].numNodes++;
+  node.reach.push_back({node.chain, node.position});
+  // references to elements of unordered_map stay valid on rehash
+  auto& newNode = mNodes.emplace(taskPtr, std::move(node)).first->second;
+  markDirty(taskPtr, newNode);
+  return newNode;
+}
+
+/*
+ * Merge the nodes reaching `predecessor` into the nodes reaching `node`.
+ * Return true if the reachability of `node` changes.
+ */
+bool TaskDependenceGraph::mergeReachability(ReachabilityNode& node, const ReachabilityNode& predecessor) {
+  auto changed = false;
+  std::vector<ChainReach> merged;
+  merged.reserve(node.reach.size() + predecessor.reach.size());
+  auto it = node.reach.begin();
+  auto predIt = predecessor.reach.begin();
+  while (it != node.reach.end() || predIt != predecessor.reach.end()) {
+    if (predIt == predecessor.reach.end() || (it != node.reach.end() && it->chain < predIt->chain)) {
+      merged.push_back(*it++);
+    } else if (it == node.reach.end() || predIt->chain < it->chain) {
+      merged.push_back(*predIt++);
+      changed = true;
+    } else {
+      if (predIt->position > it->position) {
+        changed = true;
+      }
+      merged.push_back({it->chain, std::max(it->position, predIt->position)});
+      ++it;
+      ++predIt;
+    }
+  }
+  if (changed) {
+    node.reach = std::move(merged);
+  }
+  return changed;
+}
+
+void TaskDependenceGraph::propagateReachability(void* taskPtr) {
   std::stack<void*> todo;
-  todo.push(src);
+  todo.push(taskPtr);
   while (!todo.empty()) {
     auto cur = todo.top();
-    todo.pop(); 
-    if (cur == dest) {
-      return true;
-    }
-    if (visited.find(cur) != visited.end()) {
-      continue; 
+    todo.pop();
+    auto it = mGraph.find(cur);
+    if (it == mGraph.end()) {
+      continue;
     }
-    visited[cur] = true;
-    for (const auto neighbor : mGraph[cur]) {
-      if (visited.find(neighbor) == visited.end()) {
-        todo.push(neighbor);
+    auto& curNode = mNodes.find(cur)->second;
+    for (const auto successor : it->second) {
+      auto& successorNode = mNodes.find(successor)->second;
+      if (successor != cur && mergeReachability(successorNode, curNode)) {
+        markDirty(successor, successorNode);
+        todo.push(successor);
       }
     }
   }
-  return false;
+}
+
+/*
+ * Answer reachability from the published chain decomposition index with a
+ * binary search, without taking the lock of the parallel region.
+ */
+bool TaskDependenceGraph::hasPath(void* src, void* dest) const {
+  EpochReadGuard guard;
+  auto srcNode = loadNode(src);
+  if (srcNode == nullptr) {
+    return false;	
+  }
+  if (src == dest) {
+    return true;
+  }
+  auto destNode = loadNode(dest);
+  if (destNode == nullptr) {
+    // dest has no predecessor
+    return false;
+  }
+  const auto& reach = destNode->reach;
+  auto it = std::lower_bound(reach.begin(), reach.end(), srcNode->chain, 
+                             [](const ChainReach& entry, uint32_t chain) { return entry.chain < chain; });
+  return it != reach.end() && it->chain == srcNode->chain && it->position >= srcNode->position;
+}
+
+/*
+ * Remove tasks which are no longer referenced. Tasks registered as writers
+ * or readers of a dependence variable are kept since later tasks may still
+ * depend on them.
+ * Collection runs once the number of nodes has doubled since the previous
+ * collection, so its cost is amortized over the added nodes.
+ */
+void TaskDependenceGraph::collectDeadTasks() {
+  if (mNodes.size() < mCollectThreshold) {
+    return;
+  }
+  std::unordered_set<void*> registeredTasks;
+  for (auto& shard : mShards) {
+    mcs_node_t node;
+    LockGuard guard(&(shard.lock), &node, nullptr);
+    for (const auto& entry : shard.entries) {
+      registeredTasks.insert(entry.second.writers.begin(), entry.second.writers.end());
+      registeredTasks.insert(entry.second.readers.begin(), entry.second.readers.end());
+      registeredTasks.insert(entry.second.groupPredecessors.begin(), entry.second.groupPredecessors.end());
+    }
+  }
+  std::vector<void*> deadTasks;
+  for (const auto& entry : mNodes) {
+    auto taskData = static_cast<TaskData*>(entry.first);
+    if (taskData->getIsReferenceCounted() && !taskData->isReferenced() && 
+        registeredTasks.find(entry.first) == registeredTasks.end()) {
+      deadTasks.push_back(entry.first);
+    }
+  }
+  for (const auto taskPtr : deadTasks) {
+    removeTask(taskPtr);
+  }
+  mRetiredNodes.reclaim();
+#ifdef PERFORMANCE
+  gPerformanceCounters.bumpNumTaskDependenceNodesCollected(deadTasks.size());
+#endif
+  mCollectThreshold = std::max(static_cast<size_t>(TASK_GRAPH_MIN_COLLECT_THRESHOLD), 2 * mNodes.size());
+}
+
+inline void eraseNode(std::vector<void*>& nodes, void* taskPtr) {
+  nodes.erase(std::remove(nodes.begin(), nodes.end(), taskPtr), nodes.end());
+}
+
+inline void addNodeOnce(std::vector<void*>& nodes, void* taskPtr) {
+  if (std::find(nodes.begin(), nodes.end(), taskPtr) == nodes.end()) {
+    nodes.push_back(taskPtr);
+  }
+}
+
+/*
+ * Contract the task out of the graph. Every predecessor of the task gets an
+ * edge to every successor of the task.
+ */
+void TaskDependenceGraph::removeTask(void* taskPtr) {
+  std::vector<void*> predecessors;
+  std::vector<void*> successors;
+  auto predIt = mPredecessors.find(taskPtr);
+  if (predIt != mPredecessors.end()) {
+    predecessors = std::move(predIt->second);
+    mPredecessors.erase(predIt);
+  }
+  auto succIt = mGraph.find(taskPtr);
+  if (succIt != mGraph.end()) {
+    successors = std::move(succIt->second);
+    mGraph.erase(succIt);
+  }
+  eraseNode(successors, taskPtr);
+  for (const auto predecessor : predecessors) {
+    auto& predecessorSuccessors = mGraph[predecessor];
+    eraseNode(predecessorSuccessors, taskPtr);
+    for (const auto successor : successors) {
+      addNodeOnce(predecessorSuccessors, successor);
+    }
+    if (predecessorSuccessors.empty()) {
+      mGraph.erase(predecessor);
+    }
+  }
+  for (const auto successor : successors) {
+    auto& successorPredecessors = mPredecessors[successor];
+    eraseNode(successorPredecessors, taskPtr);
+    for (const auto predecessor : predecessors) {
+      addNodeOnce(successorPredecessors, predecessor);
+    }
+  }
+  auto nodeIt = mNodes.find(taskPtr);
+  if (nodeIt == mNodes.end()) {
+    return;
+  }
+  auto chain = nodeIt->second.chain;
+  if (--mChains[chain].numNodes == 0) {
+    mFreeChains.push_back(chain);
+  }
+  static_cast<TaskData*>(taskPtr)->dependenceNode.store(nullptr, std::memory_order_release);
+  mRetiredNodes.retire(nodeIt->second.published);
+  mNodes.erase(nodeIt);
 }
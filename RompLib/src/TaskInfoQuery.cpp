@@ -3,6 +3,17 @@
 #include <glog/logging.h>
 #include <glog/raw_logging.h>
 #include <pthread.h>
+
+#include "PerformanceCounters.h"
+
+extern PerformanceCounters gPerformanceCounters;
+
+thread_local bool tDetectionActive = false;
+thread_local uint64_t tAccessEpoch = 0;
+
+static thread_local RuntimeContext tRuntimeContext;
+static thread_local bool tRuntimeContextIsValid = false;
+
 /* 
  * Helper function to determine if the query function get available result.
  */
@@ -89,3 +100,48 @@ bool queryTaskMemoryInfo(TaskMemoryInfo& taskMemoryInfo) {
   // ompt_get_task_memory only supports blockNum = 0 in current implementation.
   return omptGetTaskMemory(&taskMemoryInfo.blockAddress, &taskMemoryInfo.blockSize, 0) == 1;
 }
+
+inline void captureTaskAddressBounds(RuntimeContext& runtimeContext) {
+  auto& bounds = runtimeContext.taskAddressBounds;
+  const auto threadData = runtimeContext.threadInfo.threadData;
+  bounds.stackBaseAddress = threadData ? reinterpret_cast<uint64_t>(threadData->stackBaseAddress) : 0;
+  bounds.stackTopAddress = threadData ? reinterpret_cast<uint64_t>(threadData->stackTopAddress) : 0;
+  const auto taskFrame = runtimeContext.taskInfo.taskFrame;
+  bounds.enterFrameAddress = taskFrame ? reinterpret_cast<uint64_t>(taskFrame->enter_frame.ptr) : 0;
+  bounds.exitFrameAddress = taskFrame ? reinterpret_cast<uint64_t>(taskFrame->exit_frame.ptr) : 0;
+  const auto& taskMemoryInfo = runtimeContext.taskMemoryInfo;
+  bounds.taskPrivateBaseAddress = reinterpret_cast<uint64_t>(taskMemoryInfo.blockAddress);
+  bounds.taskPrivateEndAddress = bounds.taskPrivateBaseAddress ? bounds.taskPrivateBaseAddress + taskMemoryInfo.blockSize : 0;
+}
+
+/*
+ * Return the cached runtime context of the current thread, refresh it first
+ * if a callback has invalidated it. Return nullptr if the runtime information
+ * is not available.
+ */
+const RuntimeContext* queryRuntimeContext() {
+  if (tRuntimeContextIsValid) {
+    return &tRuntimeContext;
+  }
+#ifdef PERFORMANCE
+  gPerformanceCounters.bumpNumRuntimeContextRefreshes();
+#endif
+  if (!queryRuntimeInfo(tRuntimeContext.threadInfo, tRuntimeContext.parallelRegionInfo, tRuntimeContext.taskInfo)) {
+    return nullptr;
+  }
+  // explicit tasks without private data have no task memory, which is fine
+  tRuntimeContext.taskMemoryInfo = TaskMemoryInfo();
+  queryTaskMemoryInfo(tRuntimeContext.taskMemoryInfo);
+  captureTaskAddressBounds(tRuntimeContext);
+  tRuntimeContextIsValid = true;
+  return &tRuntimeContext;
+}
+
+void invalidateRuntimeContext() {
+  tRuntimeContextIsValid = false;
+  tAccessEpoch++;
+}
+
+void advanceAccessEpoch() {
+  tAccessEpoch++;
+}
@@ -0,0 +1,244 @@
+#include "TaskLabelBackend.h"
+
+#include <glog/logging.h>
+#include <glog/raw_logging.h>
+
+#include "Core.h"
+#include "Label.h"
+
+inline BaseSegment* getLastSegment(Label* label) {
+  auto lenLabel = label->getLabelLength();
+  return label->getKthSegment(lenLabel - 1);
+}
+
+inline void setTaskLabel(TaskData* taskData, std::shared_ptr<Label>&& mutatedLabel) {
+  if (mutatedLabel != nullptr) {
+    taskData->label = std::move(mutatedLabel);
+    markTaskMutated(taskData);
+  }
+}
+
+/*
+ * Once a task encounters a taskwait, mark the task's explicit children to
+ * be taskwaited, and record the ordered section phase value
+ */
+void markExpChildSyncTaskwait(TaskData* taskData, Label* curLabel) {
+  auto segment = getLastSegment(curLabel);
+  auto phase = segment->getPhase();
+  for (auto& child : taskData->childrenExplicitTasks) {
+    auto childTaskData = static_cast<TaskData*>(child);
+    childTaskData->setIsTaskwait(true);
+    auto lastSegment = getLastSegment(childTaskData->label.get());
+    uint64_t offset, span;
+    lastSegment->getOffsetSpan(offset, span);
+    if (span == 1) { // if the last label segment is still explicit label segment, set the taskwaited flag in segment
+      lastSegment->setTaskwaited();
+      lastSegment->setTaskwaitPhase(phase);
+    }
+  }
+  taskData->childrenExplicitTasks.clear(); // clear the children after taskwait
+}
+
+/*
+ * Once a task encounters the end of taskgroup, mark all explicit task
+ * children which are inside the ending taskgroup.
+ */
+void markExpChildSyncTaskGroupEnd(TaskData* taskData, Label* curLabel) {
+  auto seg = getLastSegment(curLabel);
+  auto taskGroupId = seg->getTaskGroupId();
+  auto it = taskData->childrenExplicitTasks.begin();
+  auto lenParentLabel = curLabel->getLabelLength();
+  while (it != taskData->childrenExplicitTasks.end()) {
+    auto childTaskData = static_cast<TaskData*>(*it);
+    auto childLabel = childTaskData->label;
+    auto lenChildLabel = childLabel->getLabelLength();
+    if (lenChildLabel > lenParentLabel) {
+      // This child task is not inside current task group
+      it++;
+    } else {
+      auto lastSeg = childLabel->getLastKthSegment(1);
+      // check if the task group id matches
+      auto childTaskGroupId = lastSeg->getTaskGroupId();
+      if (childTaskGroupId == taskGroupId) {
+        auto mutatedChildLabel = mutateTaskGroupSyncChild(childLabel.get());
+        childTaskData->label = std::move(mutatedChildLabel);
+        it = taskData->childrenExplicitTasks.erase(it);
+      } else {
+        it++;
+      }
+    }
+  }
+}
+
+void TaskLabelBackend::onInitialTaskBegin(TaskData* taskData) {
+  taskData->label = generateInitialTaskLabel();
+}
+
+void TaskLabelBackend::onParallelBegin(TaskData* encounteringTaskData, ParallelRegionData* parallelRegionData) {
+  std::shared_ptr<RegionSummary> enclosing = nullptr;
+  if (encounteringTaskData && encounteringTaskData->label) {
+    enclosing = encounteringTaskData->label->getRegionSummary();
+  }
+  parallelRegionData->regionSummary = std::make_shared<RegionSummary>(enclosing);
+}
+
+/*
+ * The implicit task with index 0 has mutated the encountering task's label 
+ * to the joined label. Publish it so that records created inside this region
+ * are compared with the joined label from now on. 
+ */
+void TaskLabelBackend::onParallelEnd(TaskData* encounteringTaskData, ParallelRegionData* parallelRegionData) {
+  if (encounteringTaskData && encounteringTaskData->label && parallelRegionData->regionSummary) {
+    parallelRegionData->regionSummary->setJoinedLabel(encounteringTaskData->label);
+  }
+}
+
+void TaskLabelBackend::onImplicitTaskBegin(TaskData* parentTaskData, TaskData* taskData, unsigned int index, unsigned int actualParallelism) {
+  // begin of implcit task, create the label for this new task
+  auto newTaskLabel = generateImplicitTaskLabel((parentTaskData->label).get(), index, actualParallelism);
+  auto parallelRegionData = static_cast<ParallelRegionData*>(taskData->parallelRegionDataPtr);
+  if (parallelRegionData) {
+    newTaskLabel->setRegionSummary(parallelRegionData->regionSummary);
+  }
+  // cast to rvalue and avoid atomic ref count modification
+  setTaskLabel(taskData, std::move(newTaskLabel));
+}
+
+void TaskLabelBackend::onImplicitTaskEnd(TaskData* parentTaskData, TaskData* taskData) {
+  // The mutated label should be created separately because access history
+  // referred to labels by pointer.
+  auto mutatedLabel = mutateParentImpEnd(taskData->label.get());
+  setTaskLabel(parentTaskData, std::move(mutatedLabel));
+}
+
+void TaskLabelBackend::onSyncRegion(TaskData* taskData, [[maybe_unused]] ParallelRegionData* parallelRegionData, ompt_sync_region_t kind, ompt_scope_endpoint_t endPoint) {
+  auto labelPtr = (taskData->label).get();  // never std::move here!
+  std::shared_ptr<Label> mutatedLabel = nullptr;
+  switch(kind) {
+    case ompt_sync_region_barrier:
+    case ompt_sync_region_barrier_implicit:
+    case ompt_sync_region_barrier_explicit:
+    case ompt_sync_region_barrier_implementation:
+    {
+      if (endPoint == ompt_scope_end) {
+        mutatedLabel = mutateBarrierEnd(labelPtr);
+      }
+      break;
+    }
+    case ompt_sync_region_taskwait:
+    {
+      if (endPoint == ompt_scope_begin) {
+        mutatedLabel = mutateTaskWait(labelPtr);
+        markExpChildSyncTaskwait(taskData, labelPtr);
+      }
+      break;
+    }
+    case ompt_sync_region_taskgroup:
+    {
+      if (endPoint == ompt_scope_begin) {
+        mutatedLabel = mutateTaskGroupBegin(labelPtr);
+      } else if (endPoint == ompt_scope_end) {
+        mutatedLabel = mutateTaskGroupEnd(labelPtr);
+        markExpChildSyncTaskGroupEnd(taskData, labelPtr);
+      }
+      break;
+    }
+    default:
+      RAW_LOG(FATAL, "unknown ompt_sync_region_t type: %d", kind);
+      break;
+  }
+  setTaskLabel(taskData, std::move(mutatedLabel));
+}
+
+void TaskLabelBackend::onOrderedSection(TaskData* taskData, [[maybe_unused]] ompt_scope_endpoint_t endPoint) {
+  // the ordered section phase is bumped on both entering and exiting
+  auto mutatedLabel = mutateOrderSection(taskData->label.get());
+  setTaskLabel(taskData, std::move(mutatedLabel));
+}
+
+void TaskLabelBackend::onWork(TaskData* taskData, ompt_work_t workType, ompt_scope_endpoint_t endPoint, [[maybe_unused]] uint64_t count) {
+  auto labelPtr = (taskData->label).get();
+  std::shared_ptr<Label> mutatedLabel = nullptr;
+  switch(workType) {
+    case ompt_work_loop:
+    case ompt_work_taskloop:
+      if (endPoint == ompt_scope_begin) {
+        mutatedLabel = mutateLoopBegin(labelPtr);
+      } else if (endPoint == ompt_scope_end) {
+        mutatedLabel = mutateLoopEnd(labelPtr);
+      }
+      break;
+    case ompt_work_sections:
+      if (endPoint == ompt_scope_begin) {
+        mutatedLabel = mutateSectionBegin(labelPtr);
+      } else if (endPoint == ompt_scope_end) {
+        mutatedLabel = mutateSectionEnd(labelPtr);
+      }
+      break;
+    case ompt_work_single_executor:
+      mutatedLabel = mutateSingleExecutor(labelPtr);
+      break;
+    case ompt_work_single_other:
+      mutatedLabel = mutateSingleOther(labelPtr);
+      break;
+    case ompt_work_workshare:
+      RAW_LOG(FATAL, "ompt_work_workshare is not supported yet");
+      break;
+    case ompt_work_distribute:
+      RAW_LOG(FATAL, "ompt_work_distribute is not supported yet");
+      break;
+    default:
+      break;
+  }
+  setTaskLabel(taskData, std::move(mutatedLabel));
+}
+
+void TaskLabelBackend::onDispatch(TaskData* taskData, ompt_dispatch_t kind, ompt_data_t instance) {
+  auto parentLabel = (taskData->label).get();
+  std::shared_ptr<Label> mutatedLabel = nullptr;
+  switch(kind) {
+    case ompt_dispatch_iteration:
+      mutatedLabel = mutateWorkShareIterationDispatch(parentLabel, instance.value);
+      break;
+    case ompt_dispatch_section:
+      mutatedLabel = mutateSectionDispatch(parentLabel, instance.ptr);
+      break;
+    default:
+      RAW_LOG(FATAL, "unexpected case %d", kind);
+  }
+  setTaskLabel(taskData, std::move(mutatedLabel));
+}
+
+void TaskLabelBackend::onTaskCreate(TaskData* parentTaskData, TaskData* taskData) {
+  if (!parentTaskData->label) {
+    RAW_LOG(FATAL, "cannot get parent task label");
+    return;
+  }
+  auto parentLabel = (parentTaskData->label).get();
+  taskData->label = generateExplicitTaskLabel(parentLabel, static_cast<void*>(taskData));
+  auto mutatedParentLabel = mutateParentTaskCreate(parentLabel);
+  setTaskLabel(parentTaskData, std::move(mutatedParentLabel));
+}
+
+void TaskLabelBackend::onTaskComplete(TaskData* taskData) {
+  auto mutatedLabel = mutateTaskComplete(taskData->label.get());
+  setTaskLabel(taskData, std::move(mutatedLabel));
+}
+
+bool TaskLabelBackend::happensBefore(const Record& histRecord, const Record& curRecord, ParallelRegionData* parallelRegionData, RecordManagementInfo& recordManagementInfo) {
+  int diffIndex;
+  auto histTaskData = static_cast<TaskData*>(histRecord.getTaskPtr());
+  auto curTaskData = static_cast<TaskData*>(curRecord.getTaskPtr());
+  auto histLabel = histRecord.getLabel();
+  auto compactHistLabel = getCompactLabel(histLabel);
+  recordManagementInfo.canCompactLabel = compactHistLabel != histLabel;
+  return ::happensBefore(compactHistLabel, curRecord.getLabel(), diffIndex, histTaskData, curTaskData, parallelRegionData, recordManagementInfo);
+}
+
+/*
+ * Labels are printed in their hex encoding, use romp-label-diff to decode them.
+ */
+std::string TaskLabelBackend::timestampToString(const Record& record) const {
+  auto label = record.getLabel();
+  return label ? label->toHexEncoding() : std::string("[empty label]");
+}
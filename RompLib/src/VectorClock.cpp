@@ -0,0 +1,58 @@
+#include "VectorClock.h"
+
+#include <algorithm>
+#include <sstream>
+
+std::string epochToString(Epoch epoch) {
+  std::stringstream stream;
+  stream << getEpochClock(epoch) << "@" << getEpochIndex(epoch);
+  return stream.str();
+}
+
+uint64_t VectorClock::get(uint32_t index) const {
+  if (index >= mClock.size()) {
+    return 0;
+  }
+  return mClock[index];
+}
+
+void VectorClock::set(uint32_t index, uint64_t clock) {
+  if (index >= mClock.size()) {
+    mClock.resize(index + 1, 0);
+  }
+  mClock[index] = clock;
+}
+
+void VectorClock::increment(uint32_t index) {
+  set(index, get(index) + 1);
+}
+
+/*
+ * Take the component wise maximum of this clock and the other clock.
+ */
+void VectorClock::join(const VectorClock& other) {
+  if (other.mClock.size() > mClock.size()) {
+    mClock.resize(other.mClock.size(), 0);
+  }
+  for (size_t i = 0; i < other.mClock.size(); ++i) {
+    mClock[i] = std::max(mClock[i], other.mClock[i]);
+  }
+}
+
+/*
+ * Return true if the time step named by `epoch` is known to this clock, i.e.,
+ * the access stamped with `epoch` happens before the owner of this clock.
+ */
+bool VectorClock::covers(Epoch epoch) const {
+  return getEpochClock(epoch) <= get(getEpochIndex(epoch));
+}
+
+std::string VectorClock::toString() const {
+  std::stringstream stream;
+  stream << "<";
+  for (size_t i = 0; i < mClock.size(); ++i) {
+    stream << mClock[i] << (i + 1 < mClock.size() ? "," : "");
+  }
+  stream << ">";
+  return stream.str();
+}
@@ -0,0 +1,169 @@
+#include "VectorClockBackend.h"
+
+#include <glog/logging.h>
+#include <glog/raw_logging.h>
+
+#include "AccessControl.h"
+#include "PerformanceCounters.h"
+
+extern PerformanceCounters gPerformanceCounters;
+
+inline void updateEpoch(TaskData* taskData) {
+  auto index = taskData->clockIndex;
+  taskData->epoch = makeEpoch(index, taskData->vectorClock.get(index));
+  markTaskMutated(taskData);
+}
+
+uint32_t VectorClockBackend::allocateClockIndices(unsigned int num) {
+  auto base = mNextClockIndex.fetch_add(num);
+  if (static_cast<uint64_t>(base) + num > EPOCH_MAX_INDEX) {
+    RAW_LOG(FATAL, "running out of vector clock indices, use ROMP_HB_BACKEND=label");
+  }
+  return base;
+}
+
+void VectorClockBackend::onInitialTaskBegin(TaskData* taskData) {
+  taskData->clockIndex = 0;
+  taskData->vectorClock.set(0, 1);
+  updateEpoch(taskData);
+}
+
+void VectorClockBackend::onParallelBegin(TaskData* encounteringTaskData, ParallelRegionData* parallelRegionData) {
+  auto numParallelism = parallelRegionData->numParallelism;
+  if (encounteringTaskData == nullptr || encounteringTaskData->clockIndex != 0) {
+    // nested parallel region, implicit tasks could run concurrently with
+    // implicit tasks of sibling regions, so they get their own components.
+    parallelRegionData->clockBase = allocateClockIndices(numParallelism);
+    return;
+  }
+  if (numParallelism > mTopLevelClockSpan) {
+    mTopLevelClockBase = allocateClockIndices(numParallelism);
+    mTopLevelClockSpan = numParallelism;
+  }
+  parallelRegionData->clockBase = mTopLevelClockBase;
+}
+
+void VectorClockBackend::onParallelEnd([[maybe_unused]] TaskData* encounteringTaskData, [[maybe_unused]] ParallelRegionData* parallelRegionData) {
+  // the join is done at the end of the implicit task with index 0
+}
+
+void VectorClockBackend::onImplicitTaskBegin(TaskData* parentTaskData, TaskData* taskData, unsigned int index, [[maybe_unused]] unsigned int actualParallelism) {
+  auto parallelRegionData = static_cast<ParallelRegionData*>(taskData->parallelRegionDataPtr);
+  RAW_CHECK(parallelRegionData != nullptr, "cannot get parallel region data");
+  RAW_CHECK(index < parallelRegionData->numParallelism, "implicit task index exceeds requested parallelism");
+  // the parent task is suspended until the end of the region, so its clock
+  // could be read by all implicit tasks without synchronization.
+  taskData->clockIndex = parallelRegionData->clockBase + index;
+  taskData->vectorClock = parentTaskData->vectorClock;
+  taskData->vectorClock.increment(taskData->clockIndex);
+  updateEpoch(taskData);
+}
+
+void VectorClockBackend::onImplicitTaskEnd(TaskData* parentTaskData, TaskData* taskData) {
+  // the implicit barrier at the end of the region has joined the clocks of
+  // all implicit tasks into this task's clock
+  parentTaskData->vectorClock.join(taskData->vectorClock);
+  parentTaskData->vectorClock.increment(parentTaskData->clockIndex);
+  updateEpoch(parentTaskData);
+}
+
+/*
+ * Every implicit task joins its clock into the barrier clock when entering
+ * the barrier and joins the barrier clock into its own clock when leaving.
+ * A task may leave barrier k and enter barrier k+1 before other tasks have
+ * left barrier k, so consecutive barriers use alternating barrier clocks.
+ * Barrier k+2 cannot be entered before all tasks have left barrier k.
+ */
+void VectorClockBackend::onSyncRegion(TaskData* taskData, ParallelRegionData* parallelRegionData, ompt_sync_region_t kind, ompt_scope_endpoint_t endPoint) {
+  switch(kind) {
+    case ompt_sync_region_barrier:
+    case ompt_sync_region_barrier_implicit:
+    case ompt_sync_region_barrier_explicit:
+    case ompt_sync_region_barrier_implementation:
+      break;
+    case ompt_sync_region_taskwait:
+    case ompt_sync_region_taskgroup:
+      // without explicit tasks there is nothing to synchronize with
+      return;
+    default:
+      RAW_LOG(FATAL, "unknown ompt_sync_region_t type: %d", kind);
+      return;
+  }
+  if (parallelRegionData == nullptr) {
+    // Worker threads report the end of the implicit barrier of a parallel
+    // region after the region is gone. The implicit task ends right after.
+    // This is also the case for barriers outside of any parallel region.
+    if (endPoint == ompt_scope_end) {
+      taskData->numBarriers++;
+    }
+    return;
+  }
+  auto& barrierClock = parallelRegionData->barrierClocks[taskData->numBarriers % 2];
+  pfq_rwlock_node_t node;
+#ifdef PERFORMANCE
+  ReaderWriterLockGuard guard(&(parallelRegionData->lock), &node, &gPerformanceCounters);
+#else
+  ReaderWriterLockGuard guard(&(parallelRegionData->lock), &node, nullptr);
+#endif
+  if (endPoint == ompt_scope_begin) {
+    guard.upgradeFromReaderToWriter();
+    barrierClock.join(taskData->vectorClock);
+  } else if (endPoint == ompt_scope_end) {
+    taskData->vectorClock.join(barrierClock);
+    taskData->vectorClock.increment(taskData->clockIndex);
+    taskData->numBarriers++;
+    updateEpoch(taskData);
+  }
+}
+
+void VectorClockBackend::onOrderedSection([[maybe_unused]] TaskData* taskData, [[maybe_unused]] ompt_scope_endpoint_t endPoint) {
+  RAW_LOG(FATAL, "ordered section is not supported by vector clock backend, use ROMP_HB_BACKEND=label");
+}
+
+void VectorClockBackend::onWork([[maybe_unused]] TaskData* taskData, ompt_work_t workType, [[maybe_unused]] ompt_scope_endpoint_t endPoint, [[maybe_unused]] uint64_t count) {
+  switch(workType) {
+    case ompt_work_taskloop:
+      RAW_LOG(FATAL, "taskloop is not supported by vector clock backend, use ROMP_HB_BACKEND=label");
+      break;
+    case ompt_work_workshare:
+      RAW_LOG(FATAL, "ompt_work_workshare is not supported yet");
+      break;
+    case ompt_work_distribute:
+      RAW_LOG(FATAL, "ompt_work_distribute is not supported yet");
+      break;
+    default:
+      // the implied barrier, if any, is reported as sync region
+      break;
+  }
+}
+
+void VectorClockBackend::onDispatch([[maybe_unused]] TaskData* taskData, [[maybe_unused]] ompt_dispatch_t kind, [[maybe_unused]] ompt_data_t instance) {
+  // iterations and sections of one implicit task are ordered by program order
+}
+
+void VectorClockBackend::onTaskCreate([[maybe_unused]] TaskData* parentTaskData, [[maybe_unused]] TaskData* taskData) {
+  RAW_LOG(FATAL, "explicit task is not supported by vector clock backend, use ROMP_HB_BACKEND=label");
+}
+
+void VectorClockBackend::onTaskComplete([[maybe_unused]] TaskData* taskData) {
+}
+
+bool VectorClockBackend::happensBefore(const Record& histRecord, const Record& curRecord, [[maybe_unused]] ParallelRegionData* parallelRegionData, RecordManagementInfo& recordManagementInfo) {
+  auto histEpoch = histRecord.getEpoch();
+  if (histEpoch == curRecord.getEpoch()) {
+    recordManagementInfo.nodeRelation = eSameNode;
+    return true;
+  }
+  // the current task is running on this thread, its clock is stable
+  auto curTaskData = static_cast<TaskData*>(curRecord.getTaskPtr());
+  if (curTaskData->vectorClock.covers(histEpoch)) {
+    recordManagementInfo.nodeRelation = eHappensBefore;
+    return true;
+  }
+  recordManagementInfo.nodeRelation = eNonSiblingParallel;
+  return false;
+}
+
+std::string VectorClockBackend::timestampToString(const Record& record) const {
+  return epochToString(record.getEpoch());
+}
@@ -0,0 +1,94 @@
+#include "lock-wait.h"
+
+#include <chrono>
+#include <climits>
+#include <linux/futex.h>
+#include <sched.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include "PerformanceCounters.h"
+
+extern PerformanceCounters gPerformanceCounters;
+
+#ifdef LOCK_SPIN_THEN_PARK
+static inline void
+futex_wait(lock_flag_t *flag, uint32_t value)
+{
+  // returns immediately if the flag no longer holds the value
+  syscall(SYS_futex, reinterpret_cast<uint32_t*>(flag), FUTEX_WAIT_PRIVATE, value, nullptr, nullptr, 0);
+}
+
+static inline void
+futex_wake(lock_flag_t *flag, int num_waiters)
+{
+  syscall(SYS_futex, reinterpret_cast<uint32_t*>(flag), FUTEX_WAKE_PRIVATE, num_waiters, nullptr, nullptr, 0);
+}
+#endif
+
+void
+lock_flag_wait(lock_flag_t *flag, [[maybe_unused]] LockWaitType type)
+{
+  if (std::atomic_load_explicit(flag, std::memory_order_acquire) == LOCK_FLAG_CLEAR) {
+    return;
+  }
+#ifdef PERFORMANCE
+  auto start = std::chrono::steady_clock::now();
+#endif
+  uint32_t spins = 0;
+  uint32_t value;
+  while ((value = std::atomic_load_explicit(flag, std::memory_order_acquire)) != LOCK_FLAG_CLEAR) {
+#ifdef LOCK_SPIN_THEN_PARK
+    if (spins >= LOCK_SPIN_LIMIT) {
+      //------------------------------------------------------------------
+      // announce that a waiter is parked, so that the thread clearing
+      // the flag wakes us up. retry if the flag changed meanwhile
+      //------------------------------------------------------------------
+      if (value == LOCK_FLAG_SET &&
+          !std::atomic_compare_exchange_weak_explicit(flag, &value, LOCK_FLAG_PARKED,
+                                                      std::memory_order_relaxed,
+                                                      std::memory_order_relaxed)) {
+        continue;
+      }
+      futex_wait(flag, LOCK_FLAG_PARKED);
+#ifdef PERFORMANCE
+      gPerformanceCounters.bumpNumLockParks();
+#endif
+      continue;
+    }
+#endif
+    spins++;
+    lock_cpu_relax();
+  }
+#ifdef PERFORMANCE
+  auto waited = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start);
+  gPerformanceCounters.recordLockWaitTime(type, waited.count());
+#endif
+}
+
+void
+lock_flag_clear(lock_flag_t *flag, [[maybe_unused]] bool wake_all)
+{
+#ifdef LOCK_SPIN_THEN_PARK
+  if (std::atomic_exchange_explicit(flag, LOCK_FLAG_CLEAR, std::memory_order_release) == LOCK_FLAG_PARKED) {
+    // a waiter that has returned already only sees a spurious wake up
+    futex_wake(flag, wake_all ? INT_MAX : 1);
+  }
+#else
+  std::atomic_store_explicit(flag, LOCK_FLAG_CLEAR, std::memory_order_release);
+#endif
+}
+
+void
+lock_spin_relax(uint32_t *spins)
+{
+#ifdef LOCK_SPIN_THEN_PARK
+  if (*spins >= LOCK_SPIN_LIMIT) {
+    // the thread we wait for may be descheduled, give up the cpu
+    sched_yield();
+    return;
+  }
+#endif
+  (*spins)++;
+  lock_cpu_relax();
+}
@@ -98,7 +98,7 @@ mcs_lock(mcs_lock_t *l, mcs_node_t *me)
     //------------------------------------------------------------------
     // prepare to block until signaled by my predecessor
     //------------------------------------------------------------------
-    std::atomic_init(&me->blocked, true);
+    std::atomic_init(&me->blocked, LOCK_FLAG_SET);
 
     //------------------------------------------------------------------
     // link behind my predecessor
@@ -113,7 +113,7 @@ mcs_lock(mcs_lock_t *l, mcs_node_t *me)
     //       critical section will not occur until after blocked is
     //       cleared
     //------------------------------------------------------------------
-    while (std::atomic_load_explicit(&me->blocked, std::memory_order_acquire));
+    lock_flag_wait(&me->blocked, eMutexWait);
   }
 }
 
@@ -174,8 +174,11 @@ mcs_unlock(mcs_lock_t *l, mcs_node_t *me)
     // another thread is writing me->next to define itself as our successor;
     // wait for it to finish that
     //------------------------------------------------------------------
-    while (mcs_nil == (successor = std::atomic_load_explicit(&me->next, std::memory_order_acquire)));
+    uint32_t spins = 0;
+    while (mcs_nil == (successor = std::atomic_load_explicit(&me->next, std::memory_order_acquire))) {
+      lock_spin_relax(&spins);
+    }
   }
 
-  std::atomic_store_explicit(&successor->blocked, false, std::memory_order_release);
+  lock_flag_clear(&successor->blocked, false);
 }
@@ -113,13 +113,14 @@ pfq_rwlock_init(pfq_rwlock_t *l)
   std::atomic_init(&l->rin, 0);
   std::atomic_init(&l->rout, 0);
   std::atomic_init(&l->last, 0);
-  std::atomic_init(&l->writer_blocking_readers[0].bit, false);
-  std::atomic_init(&l->writer_blocking_readers[1].bit, false);
+  std::atomic_init(&l->writer_blocking_readers[0].bit, LOCK_FLAG_CLEAR);
+  std::atomic_init(&l->writer_blocking_readers[1].bit, LOCK_FLAG_CLEAR);
   mcs_init(&l->wtail);
   l->whead = mcs_nil;
 }
 
-void
+// return true if a writer is present when the reader arrives
+bool
 pfq_rwlock_read_lock(pfq_rwlock_t *l, PerformanceCounters* performanceCounters)
 {
   uint32_t ticket = std::atomic_fetch_add_explicit(&l->rin, READER_INCREMENT, std::memory_order_acq_rel);
@@ -132,8 +133,10 @@ pfq_rwlock_read_lock(pfq_rwlock_t *l, PerformanceCounters* performanceCounters)
       performanceCounters->bumpNumAccessControlContention();
     }
 #endif
-    while (std::atomic_load_explicit(&l->writer_blocking_readers[phase].bit, std::memory_order_acquire));
+    lock_flag_wait(&l->writer_blocking_readers[phase].bit, eReadWait);
+    return true;
   }
+  return false;
 }
 
 void
@@ -146,7 +149,7 @@ pfq_rwlock_read_unlock(pfq_rwlock_t *l)
     // finish reading counter before reading last
     //----------------------------------------------------------------------------
     if (ticket == std::atomic_load_explicit(&l->last, std::memory_order_acquire))
-      std::atomic_store_explicit(&l->whead->blocked, false, std::memory_order_release);
+      lock_flag_clear(&l->whead->blocked, false);
   }
 }
 
@@ -162,7 +165,7 @@ pfq_rwlock_write_lock(pfq_rwlock_t *l, pfq_rwlock_node_t *me)
   //--------------------------------------------------------------------
   // this may be false when at the head of the mcs queue
   //--------------------------------------------------------------------
-  std::atomic_store_explicit(&me->blocked, true, std::memory_order_relaxed);
+  std::atomic_store_explicit(&me->blocked, LOCK_FLAG_SET, std::memory_order_relaxed);
 
   //--------------------------------------------------------------------
   // announce myself as next writer
@@ -173,7 +176,7 @@ pfq_rwlock_write_lock(pfq_rwlock_t *l, pfq_rwlock_node_t *me)
   // set writer_blocking_readers to block any readers in the next batch
   //--------------------------------------------------------------------
   uint32_t phase = std::atomic_load_explicit(&l->rin, std::memory_order_relaxed) & PHASE_BIT;
-  std::atomic_store_explicit(&l->writer_blocking_readers[phase].bit, true, std::memory_order_release); 
+  std::atomic_store_explicit(&l->writer_blocking_readers[phase].bit, LOCK_FLAG_SET, std::memory_order_release); 
 
   //----------------------------------------------------------------------------
   // store to writer_blocking_headers bit must complete before incrementing rin
@@ -202,7 +205,7 @@ pfq_rwlock_write_lock(pfq_rwlock_t *l, pfq_rwlock_node_t *me)
   // if any reads are active, wait for last reader to signal me
   //--------------------------------------------------------------------
   if (in != out) {
-    while (std::atomic_load_explicit(&me->blocked, std::memory_order_acquire));
+    lock_flag_wait(&me->blocked, eWriteWait);
     // wait for active reads to drain
 
     //--------------------------------------------------------------------------
@@ -240,7 +243,7 @@ pfq_rwlock_write_unlock(pfq_rwlock_t *l, pfq_rwlock_node_t *me)
   //--------------------------------------------------------------------
   // clear writer_blocking_readers to release waiting readers in the current read phase
   //--------------------------------------------------------------------
-  std::atomic_store_explicit(&l->writer_blocking_readers[phase].bit, false, std::memory_order_release);
+  lock_flag_clear(&l->writer_blocking_readers[phase].bit, true);
 
   //--------------------------------------------------------------------
   // pass writer lock to next writer
@@ -266,7 +269,7 @@ bool pfq_rwlock_upgrade_from_read_to_write_lock(pfq_rwlock_t *l, pfq_rwlock_node
   //--------------------------------------------------------------------
   // this may be false when at the head of the mcs queue
   //--------------------------------------------------------------------
-  std::atomic_store_explicit(&me->blocked, true, std::memory_order_relaxed);
+  std::atomic_store_explicit(&me->blocked, LOCK_FLAG_SET, std::memory_order_relaxed);
 
   //--------------------------------------------------------------------
   // announce myself as next writer
@@ -277,7 +280,7 @@ bool pfq_rwlock_upgrade_from_read_to_write_lock(pfq_rwlock_t *l, pfq_rwlock_node
   // set writer_blocking_readers to block any readers in the next batch
   //--------------------------------------------------------------------
   uint32_t phase = std::atomic_load_explicit(&l->rin, std::memory_order_relaxed) & PHASE_BIT;
-  std::atomic_store_explicit(&l->writer_blocking_readers[phase].bit, true, std::memory_order_release); 
+  std::atomic_store_explicit(&l->writer_blocking_readers[phase].bit, LOCK_FLAG_SET, std::memory_order_release); 
 
   //----------------------------------------------------------------------------
   // store to writer_blocking_headers bit must complete before incrementing rin
@@ -312,7 +315,7 @@ bool pfq_rwlock_upgrade_from_read_to_write_lock(pfq_rwlock_t *l, pfq_rwlock_node
       performanceCounters->bumpNumAccessControlWriteReadContention();
     }
 #endif
-    while (std::atomic_load_explicit(&me->blocked, std::memory_order_acquire));
+    lock_flag_wait(&me->blocked, eWriteWait);
     // wait for active reads to drain
 
     //--------------------------------------------------------------------------
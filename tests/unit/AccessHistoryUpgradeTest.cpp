@@ -0,0 +1,99 @@
+#include <atomic>
+#include <cstdint>
+#include <glog/raw_logging.h>
+#include <thread>
+#include <vector>
+
+#include "AccessControl.h"
+#include "AccessHistory.h"
+#include "ShadowLockTable.h"
+
+/*
+ * The owner of the access history serves as a counter here, setting it
+ * bumps the version like updating the records does.
+ */
+static uint64_t getCount(const AccessHistory& accessHistory) {
+  return reinterpret_cast<uint64_t>(accessHistory.getOwner());
+}
+
+static void setCount(AccessHistory& accessHistory, uint64_t count) {
+  accessHistory.setOwner(reinterpret_cast<void*>(count));
+}
+
+/*
+ * Two readers that upgrade at the same time are serialized. The first one
+ * finds the version unchanged, the second one finds the update of the first.
+ */
+static void testConcurrentUpgradesSeeEachOther() {
+  AccessHistory accessHistory;
+  setCount(accessHistory, 0);
+  std::atomic<int> numReaders(0);
+  std::atomic<int> numUnchanged(0);
+  auto upgrade = [&]() {
+    pfq_rwlock_node_t me;
+    ReaderWriterLockGuard guard(&(accessHistory.getLock()), &me, nullptr);
+    auto version = accessHistory.getVersion();
+    auto count = getCount(accessHistory);
+    // both readers hold the reader lock before either upgrades
+    numReaders++;
+    while (numReaders.load() < 2) {
+      std::this_thread::yield();
+    }
+    guard.upgradeFromReaderToWriter();
+    if (accessHistory.getVersion() == version) {
+      RAW_CHECK(getCount(accessHistory) == count, "history changed without a version change");
+      numUnchanged++;
+    }
+    setCount(accessHistory, getCount(accessHistory) + 1);
+  };
+  std::thread first(upgrade);
+  std::thread second(upgrade);
+  first.join();
+  second.join();
+  RAW_CHECK(numUnchanged.load() == 1, "exactly one upgrade should find the version unchanged");
+  RAW_CHECK(getCount(accessHistory) == 2, "an update was lost");
+}
+
+/*
+ * Every thread reads the count under the reader lock and increments it
+ * after upgrading. If the version is unchanged the count read before the
+ * upgrade is still valid, otherwise it is read again with the writer lock.
+ */
+static void testVersionValidatedIncrements() {
+  const int numThreads = 8;
+  const int numIncrements = 5000;
+  AccessHistory accessHistory;
+  setCount(accessHistory, 0);
+  std::atomic<uint64_t> numRetries(0);
+  std::vector<std::thread> threads;
+  for (int i = 0; i < numThreads; ++i) {
+    threads.emplace_back([&]() {
+      for (int j = 0; j < numIncrements; ++j) {
+        pfq_rwlock_node_t me;
+        ReaderWriterLockGuard guard(&(accessHistory.getLock()), &me, nullptr);
+        auto version = accessHistory.getVersion();
+        auto count = getCount(accessHistory);
+        guard.upgradeFromReaderToWriter();
+        if (accessHistory.getVersion() != version) {
+          numRetries++;
+          count = getCount(accessHistory);
+        }
+        setCount(accessHistory, count + 1);
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  RAW_CHECK(getCount(accessHistory) == numThreads * numIncrements, "an increment was lost");
+  RAW_LOG(INFO, "upgrades retried: %lu", numRetries.load());
+}
+
+int main() {
+#ifdef STRIPED_SHADOW_LOCKS
+  gShadowLockTable.init(0);
+#endif
+  testConcurrentUpgradesSeeEachOther();
+  testVersionValidatedIncrements();
+  return 0;
+}
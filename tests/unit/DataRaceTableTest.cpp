@@ -0,0 +1,71 @@
+#include <atomic>
+#include <cstdint>
+#include <glog/raw_logging.h>
+#include <set>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "DataRaceTable.h"
+
+static void* getInstruction(uint64_t index) {
+  return reinterpret_cast<void*>(0x400000 + index * 4);
+}
+
+/*
+ * Every thread records the same instruction pairs, in both orders. Each
+ * pair must be recorded exactly once.
+ */
+static void testConcurrentRecording() {
+  const int numThreads = 4;
+  const uint64_t numPairs = 200;
+  DataRaceTable table;
+  table.init(1024);
+  std::atomic<uint64_t> numRecorded(0);
+  std::vector<std::thread> threads;
+  for (int i = 0; i < numThreads; ++i) {
+    threads.emplace_back([&, i]() {
+      for (uint64_t j = 0; j < numPairs; ++j) {
+        auto first = getInstruction(j);
+        auto second = getInstruction(j + numPairs);
+        auto isNew = i % 2 == 0 ? table.recordDataRace(first, second, j) : table.recordDataRace(second, first, j);
+        if (isNew) {
+          numRecorded++;
+        }
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  RAW_CHECK(numRecorded.load() == numPairs, "a pair was recorded more or less than once");
+  auto dataRaces = table.getDataRaces();
+  RAW_CHECK(dataRaces.size() == numPairs, "published entries do not match the recorded pairs");
+  std::set<std::pair<void*, void*> > pairs;
+  for (const auto& dataRace : dataRaces) {
+    auto first = std::min(dataRace.instnAddrPrev, dataRace.instnAddrCur);
+    auto second = std::max(dataRace.instnAddrPrev, dataRace.instnAddrCur);
+    RAW_CHECK(reinterpret_cast<uint64_t>(second) - reinterpret_cast<uint64_t>(first) == numPairs * 4,
+              "published entry mixes two pairs");
+    pairs.emplace(first, second);
+  }
+  RAW_CHECK(pairs.size() == numPairs, "a pair was published twice");
+  RAW_CHECK(table.getNumDroppedDataRaces() == 0, "pairs were dropped below capacity");
+}
+
+static void testFullTableDropsNewPairs() {
+  DataRaceTable table;
+  table.init(4);
+  for (uint64_t i = 0; i < 6; ++i) {
+    table.recordDataRace(getInstruction(i), getInstruction(i + 100), i);
+  }
+  RAW_CHECK(table.getDataRaces().size() == 4, "full table recorded more pairs than its capacity");
+  RAW_CHECK(table.getNumDroppedDataRaces() == 2, "pairs found after the table is full are not counted");
+  RAW_CHECK(!table.recordDataRace(getInstruction(100), getInstruction(0), 0), "recorded pair is recorded again");
+}
+
+int main() {
+  testConcurrentRecording();
+  testFullTableDropsNewPairs();
+  return 0;
+}
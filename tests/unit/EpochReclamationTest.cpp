@@ -0,0 +1,93 @@
+#include <atomic>
+#include <cstdint>
+#include <glog/raw_logging.h>
+#include <thread>
+#include <vector>
+
+#include "EpochReclamation.h"
+
+#define OBJECT_MAGIC 0x5eedULL
+
+static std::atomic<int> gNumLiveObjects(0);
+
+typedef struct SharedObject {
+  SharedObject() : magic(OBJECT_MAGIC) { gNumLiveObjects++; }
+  ~SharedObject() { magic = 0; gNumLiveObjects--; }
+  volatile uint64_t magic;
+} SharedObject;
+
+/*
+ * An object retired while a reader is inside a read section is kept until
+ * the reader leaves, readers that enter later do not hold it back.
+ */
+static void testActiveReaderDefersReclamation() {
+  RetireList<SharedObject> retireList;
+  std::atomic<int> readerState(0); // 1: in read section, 2: asked to leave
+  std::thread reader([&readerState]() {
+    EpochReadGuard guard;
+    readerState.store(1);
+    while (readerState.load() != 2) {
+      std::this_thread::yield();
+    }
+  });
+  while (readerState.load() != 1) {
+    std::this_thread::yield();
+  }
+  retireList.retire(new SharedObject());
+  retireList.reclaim();
+  RAW_CHECK(gNumLiveObjects.load() == 1, "object freed under an active reader");
+  readerState.store(2);
+  reader.join();
+  {
+    EpochReadGuard laterGuard;
+    retireList.reclaim();
+  }
+  RAW_CHECK(gNumLiveObjects.load() == 0, "object not freed once its readers left");
+}
+
+/*
+ * Readers keep dereferencing the published object while a writer replaces
+ * and retires it. A reader must never see a freed object.
+ */
+static void testConcurrentReplace() {
+  const int numReaders = 4;
+  const int numReplaces = 20000;
+  std::atomic<SharedObject*> published(new SharedObject());
+  std::atomic<bool> stop(false);
+  std::atomic<uint64_t> numFreedSeen(0);
+  std::vector<std::thread> readers;
+  for (int i = 0; i < numReaders; ++i) {
+    readers.emplace_back([&]() {
+      while (!stop.load(std::memory_order_relaxed)) {
+        EpochReadGuard guard;
+        auto object = published.load(std::memory_order_acquire);
+        if (object->magic != OBJECT_MAGIC) {
+          numFreedSeen++;
+        }
+      }
+    });
+  }
+  {
+    RetireList<SharedObject> retireList;
+    for (int i = 0; i < numReplaces; ++i) {
+      auto oldObject = published.exchange(new SharedObject(), std::memory_order_acq_rel);
+      retireList.retire(oldObject);
+      retireList.reclaim();
+    }
+    stop.store(true);
+    for (auto& reader : readers) {
+      reader.join();
+    }
+    retireList.reclaim();
+    RAW_CHECK(gNumLiveObjects.load() == 1, "retired objects not freed after readers left");
+  }
+  delete published.load();
+  RAW_CHECK(numFreedSeen.load() == 0, "reader saw a freed object");
+  RAW_CHECK(gNumLiveObjects.load() == 0, "objects leaked");
+}
+
+int main() {
+  testActiveReaderDefersReclamation();
+  testConcurrentReplace();
+  return 0;
+}
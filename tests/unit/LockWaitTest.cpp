@@ -0,0 +1,95 @@
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <glog/raw_logging.h>
+#include <thread>
+#include <vector>
+
+#include "mcs-lock.h"
+#include "pfq-rwlock.h"
+
+#define NUM_THREADS 6
+#define NUM_ITERATIONS 300
+
+/*
+ * With -DLOCK_SPIN_THEN_PARK the lock holders sleep now and then, so that
+ * waiters run out of spins and park. Spinning waiters would burn the cpu
+ * the sleeping holder needs, so holders do not sleep in the default build.
+ */
+static void holdForAWhile([[maybe_unused]] int iteration) {
+#ifdef LOCK_SPIN_THEN_PARK
+  if (iteration % 50 == 0) {
+    std::this_thread::sleep_for(std::chrono::microseconds(200));
+  }
+#endif
+}
+
+static void testMcsLockExcludes() {
+  mcs_lock_t lock;
+  mcs_init(&lock);
+  uint64_t counter = 0;
+  std::vector<std::thread> threads;
+  for (int i = 0; i < NUM_THREADS; ++i) {
+    threads.emplace_back([&]() {
+      for (int j = 0; j < NUM_ITERATIONS; ++j) {
+        mcs_node_t me;
+        mcs_lock(&lock, &me);
+        auto value = counter;
+        holdForAWhile(j);
+        counter = value + 1;
+        mcs_unlock(&lock, &me);
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  RAW_CHECK(counter == NUM_THREADS * NUM_ITERATIONS, "mcs lock let two holders in");
+}
+
+/*
+ * Writers keep two values equal, readers must never see them differ. Every
+ * wait of the pfq lock goes through lock_flag_wait and lock_flag_clear.
+ */
+static void testPfqLockExcludesWriters() {
+  pfq_rwlock_t lock;
+  pfq_rwlock_init(&lock);
+  uint64_t first = 0;
+  uint64_t second = 0;
+  std::atomic<uint64_t> numTornReads(0);
+  std::vector<std::thread> threads;
+  for (int i = 0; i < NUM_THREADS; ++i) {
+    auto isWriter = i % 2 == 0;
+    threads.emplace_back([&, isWriter]() {
+      for (int j = 0; j < NUM_ITERATIONS; ++j) {
+        if (isWriter) {
+          pfq_rwlock_node_t me;
+          pfq_rwlock_write_lock(&lock, &me);
+          first++;
+          holdForAWhile(j);
+          second++;
+          pfq_rwlock_write_unlock(&lock, &me);
+        } else {
+          pfq_rwlock_read_lock(&lock, nullptr);
+          auto firstRead = first;
+          holdForAWhile(j);
+          if (firstRead != second) {
+            numTornReads++;
+          }
+          pfq_rwlock_read_unlock(&lock);
+        }
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  RAW_CHECK(numTornReads.load() == 0, "reader overlapped a writer");
+  RAW_CHECK(first == (NUM_THREADS + 1) / 2 * NUM_ITERATIONS && second == first, "pfq lock let two writers in");
+}
+
+int main() {
+  testMcsLockExcludes();
+  testPfqLockExcludesWriters();
+  return 0;
+}
@@ -0,0 +1,84 @@
+#include <cmath>
+#include <cstdint>
+#include <glog/raw_logging.h>
+
+#include "SiteSampler.h"
+
+/*
+ * Run the site `numExecutions` times, return the number of sampled
+ * executions and the distance between the last two samples.
+ */
+static uint64_t runSite(SiteSampler& sampler, void* instnAddr, uint64_t numExecutions, uint64_t* lastGap = nullptr) {
+  uint64_t numSampled = 0;
+  uint64_t lastSample = 0;
+  for (uint64_t i = 1; i <= numExecutions; ++i) {
+    if (!sampler.shouldSample(instnAddr)) {
+      continue;
+    }
+    numSampled++;
+    if (lastGap && lastSample > 0) {
+      *lastGap = i - lastSample;
+    }
+    lastSample = i;
+  }
+  return numSampled;
+}
+
+static void testRateDecaysAfterEachBurst() {
+  SiteSampler sampler;
+  sampler.init(4, 0.25);
+  auto site = reinterpret_cast<void*>(0x401000);
+  // a new site is fully sampled for one burst
+  RAW_CHECK(runSite(sampler, site, 4) == 4, "first burst is not fully sampled");
+  // then one in two executions, then one in four
+  RAW_CHECK(runSite(sampler, site, 8) == 4, "second burst is not sampled at 1/2");
+  RAW_CHECK(runSite(sampler, site, 16) == 4, "third burst is not sampled at 1/4");
+  // the rate stays at the minimum
+  RAW_CHECK(runSite(sampler, site, 400) == 100, "rate drops below the minimum");
+}
+
+static void testMinimumRateRoundsDown() {
+  SiteSampler sampler;
+  sampler.init(10, 0.001);
+  uint64_t lastGap = 0;
+  runSite(sampler, reinterpret_cast<void*>(0x402000), 100000, &lastGap);
+  RAW_CHECK(lastGap == 512, "a minimum rate of 0.001 is not rounded down to 1/512");
+}
+
+static void testDataRaceResetsSite() {
+  SiteSampler sampler;
+  sampler.init(4, 0.01);
+  auto site = reinterpret_cast<void*>(0x403000);
+  auto otherSite = reinterpret_cast<void*>(0x404000);
+  runSite(sampler, site, 10000);
+  runSite(sampler, otherSite, 10000);
+  RAW_CHECK(runSite(sampler, site, 4) < 4, "site is still fully sampled");
+  sampler.onDataRace(site);
+  RAW_CHECK(runSite(sampler, site, 4) == 4, "racing site is not fully sampled again");
+  RAW_CHECK(runSite(sampler, site, 8) == 4, "racing site does not decay again");
+  // other sites keep their rate
+  RAW_CHECK(runSite(sampler, otherSite, 4) < 4, "data race reset another site");
+}
+
+static void testInvalidMinimumRates() {
+  SiteSampler sampler;
+  uint64_t lastGap = 0;
+  // falls back to the default minimum rate of 1/512
+  sampler.init(10, NAN);
+  runSite(sampler, reinterpret_cast<void*>(0x405000), 100000, &lastGap);
+  RAW_CHECK(lastGap == 512, "nan minimum rate does not fall back to the default");
+  sampler.init(10, 0);
+  runSite(sampler, reinterpret_cast<void*>(0x406000), 100000, &lastGap);
+  RAW_CHECK(lastGap == 512, "zero minimum rate does not fall back to the default");
+  // the period is capped instead of overflowing, init must return
+  sampler.init(1, 1e-12);
+  RAW_CHECK(runSite(sampler, reinterpret_cast<void*>(0x407000), 1) == 1, "tiny minimum rate breaks sampling");
+}
+
+int main() {
+  testRateDecaysAfterEachBurst();
+  testMinimumRateRoundsDown();
+  testDataRaceResetsSite();
+  testInvalidMinimumRates();
+  return 0;
+}